@@ -0,0 +1,177 @@
+#pragma once
+
+#include "rwlock/futex.h"
+#include "rwlock/waiter_queue.h"
+#include <cerrno>
+#include <chrono>
+#include <ctime>
+#include <mutex>
+
+namespace rwlock {
+
+// FIFO queue read-write lock whose waiters can give up. Each waiter queues a
+// node on its own stack and waits on that node alone (see waiter_queue.h), so
+// a release wakes exactly the waiters it admits. Timed acquisitions
+// (try_lock_until / try_lock_for and the shared versions) unlink their node
+// when the deadline passes, letting the waiters behind move up, so a guard's
+// try_lock_for is fair, spins locally and is bounded in time.
+// BasicSharedLock / BasicUniqueLock use these instead of polling.
+//
+// Strictly FIFO: a new reader queues behind a waiting writer, and a run of
+// readers at the head of the queue is admitted together. The queue itself
+// is guarded by a short internal mutex. The timed calls return ETIMEDOUT
+// when they give up.
+class AbortableQueueRWLock {
+public:
+  AbortableQueueRWLock() = default;
+
+  // Acquire write lock (exclusive). Blocking.
+  int lock() { return acquire(/*exclusive=*/true, nullptr); }
+
+  // Acquire write lock (exclusive). Non-blocking.
+  // If rc == EBUSY, lock is held or has waiters.
+  int try_lock() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (state_ != 0 || !queue_.empty()) {
+      return EBUSY;
+    }
+    state_ = kWriter;
+    return 0;
+  }
+
+  // Acquire write lock (exclusive), giving up at timeout_time.
+  // If rc == ETIMEDOUT, the lock was not acquired in time.
+  template <class Clock, class Duration>
+  int
+  try_lock_until(const std::chrono::time_point<Clock, Duration> &timeout_time) {
+    const struct timespec deadline = detail::to_monotonic(timeout_time);
+    return acquire(/*exclusive=*/true, &deadline);
+  }
+
+  template <class Rep, class Period>
+  int try_lock_for(const std::chrono::duration<Rep, Period> &timeout_duration) {
+    return try_lock_until(std::chrono::steady_clock::now() + timeout_duration);
+  }
+
+  // Acquire read lock (shared). Blocking.
+  int lock_shared() { return acquire(/*exclusive=*/false, nullptr); }
+
+  // Acquire read lock (shared). Non-blocking.
+  // If rc == EBUSY, a writer holds the lock or the queue is not empty.
+  int try_lock_shared() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (state_ == kWriter || !queue_.empty()) {
+      return EBUSY;
+    }
+    ++state_;
+    return 0;
+  }
+
+  // Acquire read lock (shared), giving up at timeout_time.
+  // If rc == ETIMEDOUT, the lock was not acquired in time.
+  template <class Clock, class Duration>
+  int try_lock_shared_until(
+      const std::chrono::time_point<Clock, Duration> &timeout_time) {
+    const struct timespec deadline = detail::to_monotonic(timeout_time);
+    return acquire(/*exclusive=*/false, &deadline);
+  }
+
+  template <class Rep, class Period>
+  int try_lock_shared_for(
+      const std::chrono::duration<Rep, Period> &timeout_duration) {
+    return try_lock_shared_until(std::chrono::steady_clock::now() +
+                                 timeout_duration);
+  }
+
+  // Unlock from either a read or a write lock. Returns false if the lock was
+  // not held.
+  bool unlock() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (state_ == 0) {
+      return false;
+    }
+    state_ = state_ == kWriter ? 0 : state_ - 1;
+    grant_waiters();
+    return true;
+  }
+
+  // Unlock a read lock. Returns false if no read lock was held.
+  bool unlock_shared() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (state_ <= 0) {
+      return false;
+    }
+    --state_;
+    grant_waiters();
+    return true;
+  }
+
+  // Disallow move.
+  AbortableQueueRWLock(AbortableQueueRWLock &&other) = delete;
+  AbortableQueueRWLock &operator=(AbortableQueueRWLock &&other) = delete;
+
+  // Disallow copy.
+  AbortableQueueRWLock(const AbortableQueueRWLock &) = delete;
+  AbortableQueueRWLock &operator=(const AbortableQueueRWLock &) = delete;
+
+private:
+  static constexpr int kWriter = -1;
+
+  // A queued acquisition, living on the waiting thread's stack.
+  struct Waiter {
+    bool exclusive;
+    Waiter *prev = nullptr;
+    Waiter *next = nullptr;
+    detail::WaitSlot slot{};
+  };
+
+  int acquire(bool exclusive, const struct timespec *deadline) {
+    Waiter waiter{exclusive};
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      if (queue_.empty() && (exclusive ? state_ == 0 : state_ != kWriter)) {
+        state_ = exclusive ? kWriter : state_ + 1;
+        return 0;
+      }
+      queue_.push_back(&waiter);
+    }
+    if (waiter.slot.wait(deadline) == detail::WaitSlot::kGranted) {
+      return 0;
+    }
+    return abort(waiter) ? 0 : ETIMEDOUT;
+  }
+
+  // Takes a timed-out waiter out of the queue. Returns true if it was granted
+  // the lock in the meantime, which the caller then holds.
+  bool abort(Waiter &waiter) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (waiter.slot.load(std::memory_order_relaxed) ==
+        detail::WaitSlot::kGranted) {
+      return true;
+    }
+    queue_.erase(&waiter);
+    // A writer leaving the head may let readers behind it join those inside.
+    grant_waiters();
+    return false;
+  }
+
+  // Admits waiters from the head of the queue while they are compatible
+  // with the holders. Called with mutex_ held.
+  void grant_waiters() {
+    while (!queue_.empty()) {
+      Waiter *w = queue_.front();
+      if (w->exclusive ? state_ != 0 : state_ == kWriter) {
+        return;
+      }
+      state_ = w->exclusive ? kWriter : state_ + 1;
+      queue_.erase(w);
+      w->slot.resolve(detail::WaitSlot::kGranted);
+    }
+  }
+
+  std::mutex mutex_;
+  int state_ = 0; // kWriter, or the number of readers holding the lock.
+  detail::WaiterQueue<Waiter> queue_;
+};
+
+} // namespace rwlock
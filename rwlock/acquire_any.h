@@ -0,0 +1,130 @@
+#pragma once
+
+#include "rwlock/futex.h"
+#include "rwlock/futex_rw_lock.h"
+#include "rwlock/multi_lock.h"
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <span>
+#include <system_error>
+
+#include <linux/futex.h>
+
+namespace rwlock {
+
+// Takes whichever of several locks becomes available first, all in the same
+// mode, and returns its index. Contended locks are waited on together with
+// futex_waitv(2) (Linux 5.16+), so the caller sleeps until one of them is
+// released instead of polling them in turn.
+//
+// Lock is any engine with try_lock, try_lock_shared, futex_word and
+// prepare_park, such as FutexRWLock. At most FUTEX_WAITV_MAX (128) locks.
+// Like UringLockRequest, a waiting writer does not hold off new readers.
+
+namespace detail {
+
+template <class Lock> bool try_acquire(Lock &lock, LockMode mode) {
+  return (mode == LockMode::kShared ? lock.try_lock_shared()
+                                    : lock.try_lock()) == 0;
+}
+
+// One pass over the locks, starting at first so that no lock is always
+// favoured. Returns the index taken, or -1.
+template <class Lock>
+int try_acquire_from(std::span<Lock *const> locks, LockMode mode,
+                     std::size_t first) {
+  for (std::size_t n = 0; n < locks.size(); ++n) {
+    const std::size_t i = (first + n) % locks.size();
+    if (try_acquire(*locks[i], mode)) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+template <class Lock>
+int acquire_any_impl(std::span<Lock *const> locks, LockMode mode,
+                     const struct timespec *deadline) {
+  if (locks.empty() || locks.size() > FUTEX_WAITV_MAX) {
+    throw std::system_error(EINVAL, std::generic_category(),
+                            "acquire_any: need 1 to 128 locks");
+  }
+  struct futex_waitv waiters[FUTEX_WAITV_MAX] = {};
+  std::size_t first = 0;
+  for (;;) {
+    int i = try_acquire_from(locks, mode, first);
+    if (i >= 0) {
+      return i;
+    }
+    for (std::size_t j = 0; j < locks.size(); ++j) {
+      waiters[j].val = locks[j]->prepare_park();
+      waiters[j].uaddr =
+          reinterpret_cast<std::uint64_t>(futex_addr(locks[j]->futex_word()));
+      waiters[j].flags = kFutex2SizeU32 | kFutex2Private;
+    }
+    // A lock released before we flagged it would never wake us.
+    i = try_acquire_from(locks, mode, first);
+    if (i >= 0) {
+      return i;
+    }
+    i = futex_waitv(waiters, static_cast<unsigned int>(locks.size()),
+                    deadline);
+    if (i >= 0) {
+      first = static_cast<std::size_t>(i); // Try the released lock first.
+    } else if (errno == ETIMEDOUT) {
+      return -1;
+    } else if (errno != EAGAIN && errno != EINTR) {
+      throw std::system_error(errno, std::generic_category(),
+                              "acquire_any: futex_waitv failed");
+    }
+  }
+}
+
+} // namespace detail
+
+// Blocks until one of locks is acquired in mode; returns its index.
+template <class Lock = FutexRWLock>
+int acquire_any(std::span<Lock *const> locks, LockMode mode) {
+  return detail::acquire_any_impl(locks, mode, nullptr);
+}
+
+template <class Lock = FutexRWLock>
+int acquire_any(std::initializer_list<Lock *> locks, LockMode mode) {
+  return acquire_any(std::span<Lock *const>(locks.begin(), locks.size()),
+                     mode);
+}
+
+// Like acquire_any, but returns -1 if none was acquired by timeout_time.
+template <class Lock, class Clock, class Duration>
+int acquire_any_until(
+    std::span<Lock *const> locks, LockMode mode,
+    const std::chrono::time_point<Clock, Duration> &timeout_time) {
+  const struct timespec deadline = detail::to_monotonic(timeout_time);
+  return detail::acquire_any_impl(locks, mode, &deadline);
+}
+
+template <class Lock, class Clock, class Duration>
+int acquire_any_until(
+    std::initializer_list<Lock *> locks, LockMode mode,
+    const std::chrono::time_point<Clock, Duration> &timeout_time) {
+  return acquire_any_until(
+      std::span<Lock *const>(locks.begin(), locks.size()), mode, timeout_time);
+}
+
+// Non-blocking: takes the first available of locks; returns its index, or -1
+// if all are busy.
+template <class Lock = FutexRWLock>
+int try_acquire_any(std::span<Lock *const> locks, LockMode mode) {
+  return detail::try_acquire_from(locks, mode, 0);
+}
+
+template <class Lock = FutexRWLock>
+int try_acquire_any(std::initializer_list<Lock *> locks, LockMode mode) {
+  return try_acquire_any(std::span<Lock *const>(locks.begin(), locks.size()),
+                         mode);
+}
+
+} // namespace rwlock
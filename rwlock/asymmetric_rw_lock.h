@@ -0,0 +1,247 @@
+#pragma once
+
+#include "rwlock/membarrier.h"
+#include "rwlock/wait_strategy.h"
+#include "rwlock/writer_gate.h"
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+
+namespace rwlock {
+namespace detail {
+
+// Per-thread reader slots shared by every AsymmetricRWLock. Each slot holds
+// the address of a lock the thread is reading, so a thread can hold up to
+// kAsymmetricSlots read locks at once on the fast path. Records are never
+// freed, only handed to the next thread once their owner exits, so writers
+// can walk the list without locking.
+inline constexpr std::size_t kAsymmetricSlots = 8;
+
+struct alignas(64) AsymmetricReaderRecord {
+  std::atomic<const void *> slots[kAsymmetricSlots] = {};
+  std::atomic<bool> active{true};
+  AsymmetricReaderRecord *next = nullptr;
+};
+
+inline std::atomic<AsymmetricReaderRecord *> &asymmetric_records() {
+  static std::atomic<AsymmetricReaderRecord *> records{nullptr};
+  return records;
+}
+
+// Owns this thread's record for the thread's lifetime.
+class AsymmetricRecordHolder {
+public:
+  AsymmetricRecordHolder() : record_(acquire()) {}
+
+  ~AsymmetricRecordHolder() {
+    for (auto &slot : record_->slots) {
+      slot.store(nullptr, std::memory_order_release);
+    }
+    record_->active.store(false, std::memory_order_release);
+  }
+
+  AsymmetricReaderRecord *record() const { return record_; }
+
+  // Disallow move.
+  AsymmetricRecordHolder(AsymmetricRecordHolder &&other) = delete;
+  AsymmetricRecordHolder &operator=(AsymmetricRecordHolder &&other) = delete;
+
+  // Disallow copy.
+  AsymmetricRecordHolder(const AsymmetricRecordHolder &) = delete;
+  AsymmetricRecordHolder &operator=(const AsymmetricRecordHolder &) = delete;
+
+private:
+  static AsymmetricReaderRecord *acquire() {
+    std::atomic<AsymmetricReaderRecord *> &records = asymmetric_records();
+    for (AsymmetricReaderRecord *r = records.load(std::memory_order_acquire);
+         r != nullptr; r = r->next) {
+      bool expected = false;
+      if (!r->active.load(std::memory_order_relaxed) &&
+          r->active.compare_exchange_strong(expected, true,
+                                            std::memory_order_acquire)) {
+        return r;
+      }
+    }
+    auto *r = new AsymmetricReaderRecord();
+    r->next = records.load(std::memory_order_relaxed);
+    while (!records.compare_exchange_weak(r->next, r,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed)) {
+    }
+    return r;
+  }
+
+  AsymmetricReaderRecord *record_;
+};
+
+inline AsymmetricReaderRecord *this_thread_reader_record() {
+  thread_local AsymmetricRecordHolder holder;
+  return holder.record();
+}
+
+} // namespace detail
+
+// Read-write lock for data written rarely (say hourly) and read constantly.
+// A reader publishes the lock's address in a slot of its own thread's record
+// and checks the writer flag, with only a compiler barrier in between: no
+// fence, no locked instruction, no shared cache line written. The writer
+// pays instead: after setting its flag it runs membarrier(2) (see
+// membarrier.h), which executes a full fence on every running thread, so
+// each reader either is visible in its slot or sees the flag. The writer
+// then waits until no slot names the lock.
+//
+// A thread holding more than kAsymmetricSlots read locks at once takes the
+// extras through a shared atomic counter. Without membarrier support readers
+// fall back to a fence. Writer preferring. A read lock must be released by
+// the thread that took it; EAGAIN is never returned.
+template <class Wait = SpinThen<128, SleepWait<>>> class BasicAsymmetricRWLock {
+public:
+  BasicAsymmetricRWLock() {
+    detail::membarrier_available(); // Register early, off the read path.
+  }
+
+  // Acquire write lock (exclusive). Blocking.
+  // If rc == EDEADLK, the calling thread already holds the write lock.
+  int lock() {
+    const int rc = gate_.lock();
+    if (rc != 0) {
+      return rc;
+    }
+    detail::heavy_barrier();
+    Wait wait;
+    while (has_readers()) {
+      wait.pause();
+    }
+    return 0;
+  }
+
+  // Acquire write lock (exclusive). Non-blocking.
+  // If rc == EBUSY, lock is held for reading or writing.
+  int try_lock() {
+    const int rc = gate_.try_lock();
+    if (rc != 0) {
+      return rc;
+    }
+    detail::heavy_barrier();
+    if (has_readers()) {
+      gate_.unlock();
+      return EBUSY;
+    }
+    return 0;
+  }
+
+  // Acquire read lock (shared). Blocking.
+  int lock_shared() {
+    for (;;) {
+      const std::uint32_t w = arrive();
+      if (w == kFree) {
+        return 0;
+      }
+      depart();
+      gate_.park(w);
+    }
+  }
+
+  // Acquire read lock (shared). Non-blocking.
+  // If rc == EBUSY, a writer holds or is waiting for the lock.
+  int try_lock_shared() {
+    if (gate_.state(std::memory_order_relaxed) != kFree) {
+      return EBUSY;
+    }
+    if (arrive() != kFree) {
+      depart();
+      return EBUSY;
+    }
+    return 0;
+  }
+
+  // Unlock from either a read or a write lock. Returns false if the lock was
+  // not held.
+  bool unlock() {
+    if (gate_.unlock()) {
+      return true;
+    }
+    return unlock_shared();
+  }
+
+  // Unlock a read lock held by this thread. Returns false if it held none.
+  bool unlock_shared() { return depart(); }
+
+  // Disallow move.
+  BasicAsymmetricRWLock(BasicAsymmetricRWLock &&other) = delete;
+  BasicAsymmetricRWLock &operator=(BasicAsymmetricRWLock &&other) = delete;
+
+  // Disallow copy.
+  BasicAsymmetricRWLock(const BasicAsymmetricRWLock &) = delete;
+  BasicAsymmetricRWLock &operator=(const BasicAsymmetricRWLock &) = delete;
+
+private:
+  static constexpr std::uint32_t kFree = detail::WriterGate::kFree;
+
+  // Counts this reader in and returns the writer state it then observed.
+  std::uint32_t arrive() {
+    detail::AsymmetricReaderRecord *record =
+        detail::this_thread_reader_record();
+    bool published = false;
+    for (auto &slot : record->slots) {
+      if (slot.load(std::memory_order_relaxed) == nullptr) {
+        slot.store(this, std::memory_order_relaxed);
+        published = true;
+        break;
+      }
+    }
+    if (published) {
+      // Pairs with the writer's heavy_barrier: it sees our slot or we see
+      // its flag.
+      detail::light_barrier();
+    } else {
+      overflow_readers_.fetch_add(1, std::memory_order_seq_cst);
+    }
+    return gate_.state(std::memory_order_acquire);
+  }
+
+  // Counts this reader out. Returns false if it was not counted in.
+  bool depart() {
+    detail::AsymmetricReaderRecord *record =
+        detail::this_thread_reader_record();
+    for (auto &slot : record->slots) {
+      if (slot.load(std::memory_order_relaxed) == this) {
+        slot.store(nullptr, std::memory_order_release);
+        return true;
+      }
+    }
+    std::uint32_t n = overflow_readers_.load(std::memory_order_relaxed);
+    while (n != 0) {
+      if (overflow_readers_.compare_exchange_weak(
+              n, n - 1, std::memory_order_release,
+              std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool has_readers() const {
+    if (overflow_readers_.load(std::memory_order_acquire) != 0) {
+      return true;
+    }
+    for (detail::AsymmetricReaderRecord *r =
+             detail::asymmetric_records().load(std::memory_order_acquire);
+         r != nullptr; r = r->next) {
+      for (const auto &slot : r->slots) {
+        if (slot.load(std::memory_order_acquire) == this) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  alignas(64) detail::WriterGate gate_;
+  alignas(64) std::atomic<std::uint32_t> overflow_readers_{0};
+};
+
+using AsymmetricRWLock = BasicAsymmetricRWLock<>;
+
+} // namespace rwlock
@@ -0,0 +1,369 @@
+#pragma once
+
+#include <coroutine>
+#include <functional>
+#include <mutex>
+#include <utility>
+
+namespace rwlock {
+
+class AsyncRWLock;
+
+// Move-only shared ownership of an AsyncRWLock (like SharedLock). Returned by
+// co_await AsyncRWLock::shared().
+class AsyncSharedLock {
+public:
+  // Adopts a shared lock already held on rwlock.
+  AsyncSharedLock(AsyncRWLock &rwlock, std::adopt_lock_t)
+      : lock_(&rwlock), owns_lock_(true) {}
+
+  // Tries to take shared ownership of the rwlock again (non-blocking).
+  bool try_lock();
+
+  // Releases ownership of the rwlock.
+  void unlock();
+
+  // Swaps state with another async shared lock.
+  void swap(AsyncSharedLock &other) {
+    std::swap(lock_, other.lock_);
+    std::swap(owns_lock_, other.owns_lock_);
+  }
+
+  // Disassociates the rwlock without unlocking (i.e., releasing
+  // ownership of) it.
+  AsyncRWLock *release() {
+    AsyncRWLock *temp = lock_;
+    lock_ = nullptr;
+    owns_lock_ = false;
+    return temp;
+  }
+
+  // Returns a pointer to the associated rwlock.
+  AsyncRWLock *rwlock() { return lock_; }
+
+  // Returns true if we currently own the shared lock.
+  bool owns_lock() const noexcept { return owns_lock_; }
+
+  ~AsyncSharedLock() { unlock(); }
+
+  AsyncSharedLock(AsyncSharedLock &&other) noexcept
+      : lock_(other.lock_), owns_lock_(other.owns_lock_) {
+    other.lock_ = nullptr;
+    other.owns_lock_ = false;
+  }
+
+  AsyncSharedLock &operator=(AsyncSharedLock &&other) noexcept {
+    if (this != &other) {
+      unlock();
+      lock_ = other.lock_;
+      owns_lock_ = other.owns_lock_;
+
+      other.lock_ = nullptr;
+      other.owns_lock_ = false;
+    }
+    return *this;
+  }
+
+  AsyncSharedLock(const AsyncSharedLock &) = delete;
+  AsyncSharedLock &operator=(const AsyncSharedLock &) = delete;
+
+private:
+  AsyncRWLock *lock_;
+  bool owns_lock_;
+};
+
+// Move-only exclusive ownership of an AsyncRWLock (like UniqueLock). Returned
+// by co_await AsyncRWLock::exclusive().
+class AsyncUniqueLock {
+public:
+  // Adopts an exclusive lock already held on rwlock.
+  AsyncUniqueLock(AsyncRWLock &rwlock, std::adopt_lock_t)
+      : lock_(&rwlock), owns_lock_(true) {}
+
+  // Tries to take exclusive ownership of the rwlock again (non-blocking).
+  bool try_lock();
+
+  // Releases ownership of the rwlock.
+  void unlock();
+
+  // Swaps state with another async unique lock.
+  void swap(AsyncUniqueLock &other) {
+    std::swap(lock_, other.lock_);
+    std::swap(owns_lock_, other.owns_lock_);
+  }
+
+  // Disassociates the rwlock without unlocking (i.e., releasing
+  // ownership of) it.
+  AsyncRWLock *release() {
+    AsyncRWLock *temp = lock_;
+    lock_ = nullptr;
+    owns_lock_ = false;
+    return temp;
+  }
+
+  // Returns a pointer to the associated rwlock.
+  AsyncRWLock *rwlock() { return lock_; }
+
+  // Returns true if we currently own the exclusive lock.
+  bool owns_lock() const noexcept { return owns_lock_; }
+
+  ~AsyncUniqueLock() { unlock(); }
+
+  AsyncUniqueLock(AsyncUniqueLock &&other) noexcept
+      : lock_(other.lock_), owns_lock_(other.owns_lock_) {
+    other.lock_ = nullptr;
+    other.owns_lock_ = false;
+  }
+
+  AsyncUniqueLock &operator=(AsyncUniqueLock &&other) noexcept {
+    if (this != &other) {
+      unlock();
+      lock_ = other.lock_;
+      owns_lock_ = other.owns_lock_;
+
+      other.lock_ = nullptr;
+      other.owns_lock_ = false;
+    }
+    return *this;
+  }
+
+  AsyncUniqueLock(const AsyncUniqueLock &) = delete;
+  AsyncUniqueLock &operator=(const AsyncUniqueLock &) = delete;
+
+private:
+  AsyncRWLock *lock_;
+  bool owns_lock_;
+};
+
+// Read-write lock for coroutines. co_await shared() / exclusive() suspends the
+// calling coroutine instead of blocking its thread, and resumes it once the
+// lock has been handed to it. Waiters are granted in FIFO order; a run of
+// queued readers is granted together.
+class AsyncRWLock {
+  // Intrusive queue node. Lives inside the awaiter, i.e. in the suspended
+  // coroutine's frame, so waiting does not allocate.
+  struct Waiter {
+    Waiter *next = nullptr;
+    std::coroutine_handle<> handle;
+    bool exclusive;
+  };
+
+public:
+  // Schedules a granted waiter's coroutine for resumption.
+  using Executor = std::function<void(std::coroutine_handle<>)>;
+
+  // Granted waiters are resumed inline on the thread that releases the lock.
+  AsyncRWLock() = default;
+
+  // Granted waiters are resumed by handing their coroutine to executor.
+  explicit AsyncRWLock(Executor executor) : executor_(std::move(executor)) {}
+
+  // Awaitable returned by shared(). Resumes with an AsyncSharedLock.
+  class SharedAwaiter : private Waiter {
+  public:
+    bool await_ready() { return lock_->try_lock_shared(); }
+    bool await_suspend(std::coroutine_handle<> handle) {
+      this->handle = handle;
+      return lock_->enqueue(this);
+    }
+    AsyncSharedLock await_resume() {
+      return AsyncSharedLock(*lock_, std::adopt_lock);
+    }
+
+  private:
+    friend class AsyncRWLock;
+    explicit SharedAwaiter(AsyncRWLock &lock) : lock_(&lock) {
+      exclusive = false;
+    }
+    AsyncRWLock *lock_;
+  };
+
+  // Awaitable returned by exclusive(). Resumes with an AsyncUniqueLock.
+  class ExclusiveAwaiter : private Waiter {
+  public:
+    bool await_ready() { return lock_->try_lock(); }
+    bool await_suspend(std::coroutine_handle<> handle) {
+      this->handle = handle;
+      return lock_->enqueue(this);
+    }
+    AsyncUniqueLock await_resume() {
+      return AsyncUniqueLock(*lock_, std::adopt_lock);
+    }
+
+  private:
+    friend class AsyncRWLock;
+    explicit ExclusiveAwaiter(AsyncRWLock &lock) : lock_(&lock) {
+      exclusive = true;
+    }
+    AsyncRWLock *lock_;
+  };
+
+  // co_await to take shared ownership.
+  SharedAwaiter shared() { return SharedAwaiter(*this); }
+
+  // co_await to take exclusive ownership.
+  ExclusiveAwaiter exclusive() { return ExclusiveAwaiter(*this); }
+
+  // Acquire write lock (exclusive). Non-blocking. Fails if the lock is held
+  // or other coroutines are already queued for it.
+  bool try_lock() {
+    std::lock_guard<std::mutex> guard(mu_);
+    if (state_ != 0 || head_ != nullptr) {
+      return false;
+    }
+    state_ = kWriter;
+    return true;
+  }
+
+  // Acquire read lock (shared). Non-blocking. Fails if a writer holds the lock
+  // or other coroutines are already queued for it.
+  bool try_lock_shared() {
+    std::lock_guard<std::mutex> guard(mu_);
+    if (state_ == kWriter || head_ != nullptr) {
+      return false;
+    }
+    ++state_;
+    return true;
+  }
+
+  // Release the write lock and hand the lock to the next waiters.
+  void unlock() {
+    Waiter *granted;
+    {
+      std::lock_guard<std::mutex> guard(mu_);
+      state_ = 0;
+      granted = grant_locked();
+    }
+    resume(granted);
+  }
+
+  // Release a read lock. The last reader out hands the lock to the next
+  // waiters.
+  void unlock_shared() {
+    Waiter *granted;
+    {
+      std::lock_guard<std::mutex> guard(mu_);
+      if (--state_ != 0) {
+        return;
+      }
+      granted = grant_locked();
+    }
+    resume(granted);
+  }
+
+  // Disallow move.
+  AsyncRWLock(AsyncRWLock &&other) = delete;
+  AsyncRWLock &operator=(AsyncRWLock &&other) = delete;
+
+  // Disallow copy.
+  AsyncRWLock(const AsyncRWLock &) = delete;
+  AsyncRWLock &operator=(const AsyncRWLock &) = delete;
+
+private:
+  static constexpr int kWriter = -1;
+
+  // Queues waiter, unless the lock can be granted right away. Returns true if
+  // the coroutine must stay suspended.
+  bool enqueue(Waiter *waiter) {
+    std::lock_guard<std::mutex> guard(mu_);
+    if (head_ == nullptr) {
+      if (waiter->exclusive && state_ == 0) {
+        state_ = kWriter;
+        return false;
+      }
+      if (!waiter->exclusive && state_ != kWriter) {
+        ++state_;
+        return false;
+      }
+    }
+    waiter->next = nullptr;
+    if (tail_ != nullptr) {
+      tail_->next = waiter;
+    } else {
+      head_ = waiter;
+    }
+    tail_ = waiter;
+    return true;
+  }
+
+  // Dequeues the waiters that can own the lock now and marks them as owners.
+  // Returns them as a list. Caller must hold mu_.
+  Waiter *grant_locked() {
+    Waiter *first = head_;
+    Waiter *last = nullptr;
+    if (head_ == nullptr) {
+      return nullptr;
+    }
+    if (head_->exclusive) {
+      if (state_ != 0) {
+        return nullptr;
+      }
+      state_ = kWriter;
+      last = head_;
+      head_ = head_->next;
+    } else {
+      while (head_ != nullptr && !head_->exclusive) {
+        ++state_;
+        last = head_;
+        head_ = head_->next;
+      }
+    }
+    if (head_ == nullptr) {
+      tail_ = nullptr;
+    }
+    last->next = nullptr;
+    return first;
+  }
+
+  // Resumes granted waiters. A waiter may be destroyed as soon as its
+  // coroutine runs, so the next pointer is read first.
+  void resume(Waiter *waiter) {
+    while (waiter != nullptr) {
+      Waiter *next = waiter->next;
+      std::coroutine_handle<> handle = waiter->handle;
+      if (executor_) {
+        executor_(handle);
+      } else {
+        handle.resume();
+      }
+      waiter = next;
+    }
+  }
+
+  Executor executor_;
+  std::mutex mu_;
+  // kWriter if held exclusively, otherwise the number of readers.
+  int state_ = 0;
+  Waiter *head_ = nullptr;
+  Waiter *tail_ = nullptr;
+};
+
+inline bool AsyncSharedLock::try_lock() {
+  if (lock_ != nullptr && !owns_lock_) {
+    owns_lock_ = lock_->try_lock_shared();
+  }
+  return owns_lock_;
+}
+
+inline void AsyncSharedLock::unlock() {
+  if (owns_lock_) {
+    owns_lock_ = false;
+    lock_->unlock_shared();
+  }
+}
+
+inline bool AsyncUniqueLock::try_lock() {
+  if (lock_ != nullptr && !owns_lock_) {
+    owns_lock_ = lock_->try_lock();
+  }
+  return owns_lock_;
+}
+
+inline void AsyncUniqueLock::unlock() {
+  if (owns_lock_) {
+    owns_lock_ = false;
+    lock_->unlock();
+  }
+}
+
+} // namespace rwlock
@@ -0,0 +1,241 @@
+#pragma once
+
+#include "rwlock/membarrier.h"
+#include "rwlock/rw_lock.h"
+#include "rwlock/wait_strategy.h"
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace rwlock {
+
+// Biased (reservation) lock over any read-write lock engine, RWLock by
+// default, for objects that one thread locks nearly all the time. The lock
+// starts reserved for its owner thread, which then locks and unlocks with
+// plain loads and stores on a word nobody else writes. The first time
+// another thread wants the lock it revokes the reservation: it raises a
+// flag, runs membarrier(2) (see membarrier.h) so the owner either sees the
+// flag or is seen inside, waits for the owner to leave, and from then on
+// everybody, owner included, uses the underlying lock. Revocation is
+// permanent and costs a membarrier, so this only pays off when other threads
+// rarely touch the lock.
+//
+// While reserved, the owner's shared acquisitions are exclusive, and its
+// relocking in exclusive mode returns EDEADLK. Other errors come from the
+// underlying engine.
+template <class Lock = RWLock> class BiasedLock {
+public:
+  // Reserves the lock for owner, by default the constructing thread.
+  explicit BiasedLock(std::thread::id owner = std::this_thread::get_id())
+      : owner_(owner) {
+    detail::membarrier_available(); // Register early, off the owner's path.
+  }
+
+  // Acquire write lock (exclusive). Blocking.
+  int lock() {
+    if (is_owner()) {
+      if (held_ != 0) {
+        return EDEADLK;
+      }
+      if (enter()) {
+        exclusive_ = true;
+        return 0;
+      }
+    }
+    revoke();
+    return lock_.lock();
+  }
+
+  // Acquire write lock (exclusive). Non-blocking.
+  // If rc == EBUSY, lock is held for reading or writing, or the owner is
+  // inside and the reservation could not be revoked yet.
+  int try_lock() {
+    if (is_owner()) {
+      if (held_ != 0) {
+        return EDEADLK;
+      }
+      if (enter()) {
+        exclusive_ = true;
+        return 0;
+      }
+    }
+    if (!try_revoke()) {
+      return EBUSY;
+    }
+    return lock_.try_lock();
+  }
+
+  // Acquire read lock (shared). Blocking.
+  int lock_shared() {
+    if (is_owner()) {
+      if (held_ != 0) {
+        return nest_shared();
+      }
+      if (enter()) {
+        return 0;
+      }
+    }
+    revoke();
+    return lock_.lock_shared();
+  }
+
+  // Acquire read lock (shared). Non-blocking.
+  int try_lock_shared() {
+    if (is_owner()) {
+      if (held_ != 0) {
+        return nest_shared();
+      }
+      if (enter()) {
+        return 0;
+      }
+    }
+    if (!try_revoke()) {
+      return EBUSY;
+    }
+    return lock_.try_lock_shared();
+  }
+
+  // Unlock from either a read or a write lock.
+  bool unlock() { return leave() || lock_.unlock(); }
+
+  // Unlock a read lock.
+  bool unlock_shared() { return leave() || lock_.unlock_shared(); }
+
+  // Returns true while the lock is still reserved for its owner.
+  bool biased() const { return biased_.load(std::memory_order_acquire); }
+
+  // Returns the wrapped lock.
+  Lock &underlying() { return lock_; }
+
+  // Disallow move.
+  BiasedLock(BiasedLock &&other) = delete;
+  BiasedLock &operator=(BiasedLock &&other) = delete;
+
+  // Disallow copy.
+  BiasedLock(const BiasedLock &) = delete;
+  BiasedLock &operator=(const BiasedLock &) = delete;
+
+private:
+  bool is_owner() const {
+    return biased_.load(std::memory_order_relaxed) &&
+           owner_ == std::this_thread::get_id();
+  }
+
+  // Owner only: takes the reserved lock. Returns false once the reservation
+  // has been revoked. A revocation under way may still give up (try_revoke
+  // finding us inside), so we step out and wait for it to end either way
+  // rather than revoking the reservation ourselves.
+  bool enter() {
+    for (;;) {
+      held_.store(1, std::memory_order_relaxed);
+      // Pairs with the revoker's heavy_barrier: it sees held_ or we see
+      // revoking_.
+      detail::light_barrier();
+      // revoking_ is cleared only after biased_, so reading it clear and
+      // biased_ still set means no revocation has completed.
+      if (!revoking_.load(std::memory_order_acquire)) {
+        if (biased_.load(std::memory_order_relaxed)) {
+          return true;
+        }
+        held_.store(0, std::memory_order_relaxed);
+        return false;
+      }
+      held_.store(0, std::memory_order_release);
+      YieldWait wait;
+      while (revoking_.load(std::memory_order_acquire)) {
+        wait.pause();
+      }
+    }
+  }
+
+  // Owner only, already inside: a revoker is waiting for us anyway.
+  int nest_shared() {
+    if (exclusive_) {
+      return EDEADLK;
+    }
+    held_.store(held_.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+    return 0;
+  }
+
+  // Releases a reserved acquisition. Returns false if the caller holds none.
+  bool leave() {
+    if (owner_ != std::this_thread::get_id()) {
+      return false;
+    }
+    const std::uint32_t n = held_.load(std::memory_order_relaxed);
+    if (n == 0) {
+      return false;
+    }
+    if (n == 1) {
+      exclusive_ = false;
+    }
+    held_.store(n - 1, std::memory_order_release);
+    return true;
+  }
+
+  // Ends the reservation, waiting for the owner to leave.
+  void revoke() {
+    if (!biased_.load(std::memory_order_acquire)) {
+      return;
+    }
+    std::lock_guard<std::mutex> guard(revoke_mutex_);
+    if (!begin_revoke()) {
+      return;
+    }
+    YieldWait wait;
+    while (held_.load(std::memory_order_acquire) != 0) {
+      wait.pause();
+    }
+    end_revoke();
+  }
+
+  // Ends the reservation unless the owner is inside. Returns false if it is.
+  bool try_revoke() {
+    if (!biased_.load(std::memory_order_acquire)) {
+      return true;
+    }
+    std::unique_lock<std::mutex> guard(revoke_mutex_, std::try_to_lock);
+    if (!guard.owns_lock()) {
+      return false;
+    }
+    if (!begin_revoke()) {
+      return true;
+    }
+    if (held_.load(std::memory_order_acquire) != 0) {
+      revoking_.store(false, std::memory_order_release);
+      return false;
+    }
+    end_revoke();
+    return true;
+  }
+
+  // Called with revoke_mutex_ held. Returns false if already revoked.
+  bool begin_revoke() {
+    if (!biased_.load(std::memory_order_relaxed)) {
+      return false;
+    }
+    revoking_.store(true, std::memory_order_seq_cst);
+    detail::heavy_barrier();
+    return true;
+  }
+
+  void end_revoke() {
+    biased_.store(false, std::memory_order_relaxed);
+    revoking_.store(false, std::memory_order_release);
+  }
+
+  const std::thread::id owner_;
+  // Written only by the owner: its reserved acquisitions (nested shared
+  // ones counted), and whether the outermost one is exclusive.
+  std::atomic<std::uint32_t> held_{0};
+  bool exclusive_ = false;
+  std::atomic<bool> biased_{true};
+  alignas(64) std::atomic<bool> revoking_{false};
+  std::mutex revoke_mutex_;
+  Lock lock_;
+};
+
+} // namespace rwlock
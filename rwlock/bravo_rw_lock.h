@@ -0,0 +1,215 @@
+#pragma once
+
+#include "rwlock/rw_lock.h"
+#include "rwlock/wait_strategy.h"
+#include <atomic>
+#include <bitset>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace rwlock {
+namespace detail {
+
+// BRAVO's visible-readers table, shared by every BravoRWLock in the process.
+// A fast-path reader owns one slot, holding the address of its lock.
+inline constexpr std::size_t kBravoTableSize = 4096;
+
+inline std::atomic<const void *> *bravo_table() {
+  alignas(64) static std::atomic<const void *> table[kBravoTableSize];
+  return table;
+}
+
+// Slots this thread holds in the table.
+inline std::bitset<kBravoTableSize> &bravo_owned_slots() {
+  thread_local std::bitset<kBravoTableSize> owned;
+  return owned;
+}
+
+} // namespace detail
+
+// BRAVO (Biased Locking for Reader-Writer Locks, Dice & Kogan, USENIX ATC
+// 2019) over any read-write lock engine, RWLock by default. While the lock is
+// read-biased, readers skip the underlying lock entirely: each claims a slot
+// in a global table, hashed from the lock and the thread, and a write to
+// that slot's cache line is all a read acquisition costs. A writer takes the
+// underlying lock, revokes the bias and waits for the table to hold no
+// readers of its lock. Readers that miss the fast path (bias off, slot
+// taken) use the underlying lock as usual.
+//
+// Revocation scans the whole table, so the bias is only re-enabled, by a
+// slow-path reader, once a multiple of the last revocation's duration has
+// passed; write-heavy locks thus stay unbiased. Per lock this adds a flag and
+// a timestamp, not per-CPU state, so it suits programs with many locks.
+//
+// Returns the underlying engine's error codes. A read lock must be released
+// by the thread that took it.
+template <class Lock = RWLock> class BravoRWLock {
+public:
+  BravoRWLock() = default;
+
+  // Acquire write lock (exclusive). Blocking.
+  int lock() {
+    const int rc = lock_.lock();
+    if (rc == 0 && rbias_.load(std::memory_order_relaxed)) {
+      revoke();
+    }
+    return rc;
+  }
+
+  // Acquire write lock (exclusive). Non-blocking.
+  // If rc == EBUSY, lock is held for reading or writing.
+  int try_lock() {
+    const int rc = lock_.try_lock();
+    if (rc != 0 || !rbias_.load(std::memory_order_relaxed)) {
+      return rc;
+    }
+    rbias_.store(false, std::memory_order_seq_cst);
+    if (has_visible_readers()) {
+      // Fast-path readers are in; waiting for them would block.
+      rbias_.store(true, std::memory_order_relaxed);
+      lock_.unlock();
+      return EBUSY;
+    }
+    return 0;
+  }
+
+  // Acquire read lock (shared). Blocking.
+  int lock_shared() {
+    if (try_fast_read()) {
+      return 0;
+    }
+    const int rc = lock_.lock_shared();
+    if (rc == 0) {
+      maybe_enable_bias();
+    }
+    return rc;
+  }
+
+  // Acquire read lock (shared). Non-blocking.
+  int try_lock_shared() {
+    if (try_fast_read()) {
+      return 0;
+    }
+    const int rc = lock_.try_lock_shared();
+    if (rc == 0) {
+      maybe_enable_bias();
+    }
+    return rc;
+  }
+
+  // Unlock from either a read or a write lock.
+  bool unlock() { return release_fast_read() || lock_.unlock(); }
+
+  // Unlock a read lock.
+  bool unlock_shared() { return release_fast_read() || lock_.unlock_shared(); }
+
+  // Returns true while readers may take the fast path.
+  bool read_biased() const { return rbias_.load(std::memory_order_relaxed); }
+
+  // Returns the wrapped lock.
+  Lock &underlying() { return lock_; }
+
+  // Disallow move.
+  BravoRWLock(BravoRWLock &&other) = delete;
+  BravoRWLock &operator=(BravoRWLock &&other) = delete;
+
+  // Disallow copy.
+  BravoRWLock(const BravoRWLock &) = delete;
+  BravoRWLock &operator=(const BravoRWLock &) = delete;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  // Bias stays off for this many times as long as the last revocation took.
+  static constexpr int kInhibitMultiplier = 9;
+
+  // This thread's slot for this lock.
+  std::size_t slot() const {
+    static std::atomic<std::uint64_t> next{0};
+    thread_local const std::uint64_t thread_index =
+        next.fetch_add(1, std::memory_order_relaxed);
+    std::uint64_t h = reinterpret_cast<std::uintptr_t>(this) ^
+                      (thread_index * 0x9e3779b97f4a7c15ull);
+    h ^= h >> 29;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 32;
+    return static_cast<std::size_t>(h % detail::kBravoTableSize);
+  }
+
+  bool try_fast_read() {
+    if (!rbias_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    const std::size_t i = slot();
+    std::atomic<const void *> &entry = detail::bravo_table()[i];
+    const void *expected = nullptr;
+    if (!entry.compare_exchange_strong(expected, this,
+                                       std::memory_order_seq_cst)) {
+      return false; // Slot taken, maybe by this thread's other read lock.
+    }
+    // Published; recheck so a writer revoking meanwhile either sees us or
+    // we see its revocation.
+    if (rbias_.load(std::memory_order_seq_cst)) {
+      detail::bravo_owned_slots().set(i);
+      return true;
+    }
+    entry.store(nullptr, std::memory_order_release);
+    return false;
+  }
+
+  bool release_fast_read() {
+    const std::size_t i = slot();
+    std::bitset<detail::kBravoTableSize> &owned = detail::bravo_owned_slots();
+    if (!owned.test(i) ||
+        detail::bravo_table()[i].load(std::memory_order_relaxed) != this) {
+      return false;
+    }
+    owned.reset(i);
+    detail::bravo_table()[i].store(nullptr, std::memory_order_release);
+    return true;
+  }
+
+  // Called holding the underlying read lock, so no writer is revoking.
+  void maybe_enable_bias() {
+    if (!rbias_.load(std::memory_order_relaxed) &&
+        Clock::now().time_since_epoch().count() >=
+            inhibit_until_.load(std::memory_order_relaxed)) {
+      rbias_.store(true, std::memory_order_release);
+    }
+  }
+
+  // Called holding the underlying write lock.
+  void revoke() {
+    const Clock::time_point start = Clock::now();
+    rbias_.store(false, std::memory_order_seq_cst);
+    std::atomic<const void *> *table = detail::bravo_table();
+    YieldWait wait;
+    for (std::size_t i = 0; i < detail::kBravoTableSize; ++i) {
+      while (table[i].load(std::memory_order_seq_cst) == this) {
+        wait.pause();
+      }
+    }
+    const Clock::time_point end = Clock::now();
+    inhibit_until_.store(
+        (end + (end - start) * kInhibitMultiplier).time_since_epoch().count(),
+        std::memory_order_relaxed);
+  }
+
+  bool has_visible_readers() const {
+    std::atomic<const void *> *table = detail::bravo_table();
+    for (std::size_t i = 0; i < detail::kBravoTableSize; ++i) {
+      if (table[i].load(std::memory_order_seq_cst) == this) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  Lock lock_;
+  std::atomic<bool> rbias_{false};
+  std::atomic<Clock::rep> inhibit_until_{0};
+};
+
+} // namespace rwlock
@@ -0,0 +1,501 @@
+#pragma once
+
+#include "rwlock/rw_lock.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <type_traits>
+
+namespace rwlock {
+
+// Node latch for optimistic lock coupling. Combines a version counter, which
+// optimistic readers validate against, with an RWLock that writers hold while
+// modifying the node. Readers that keep failing validation fall back to
+// taking the RWLock shared.
+//
+// Version layout: bit 1 is set while a writer holds the node; every write
+// lock/unlock pair advances the version by 4.
+class VersionedLatch {
+public:
+  // Starts an optimistic read. Sets restart if the node is write-locked, after
+  // waiting for the writer to finish so the caller does not spin.
+  std::uint64_t read_lock_or_restart(bool &restart) const {
+    std::uint64_t version = version_.load(std::memory_order_acquire);
+    if (is_locked(version)) {
+      lock_.lock_shared();
+      lock_.unlock();
+      restart = true;
+    }
+    return version;
+  }
+
+  // Validates that the node has not changed since version was read. Sets
+  // restart if it has.
+  void check_or_restart(std::uint64_t version, bool &restart) const {
+    read_unlock_or_restart(version, restart);
+  }
+
+  // Ends an optimistic read. Sets restart if the node changed meanwhile, in
+  // which case anything read from it must be discarded.
+  void read_unlock_or_restart(std::uint64_t version, bool &restart) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (version != version_.load(std::memory_order_relaxed)) {
+      restart = true;
+    }
+  }
+
+  // Turns an optimistic read at version into the write lock. Blocks on the
+  // RWLock if another thread holds it. Sets restart, without holding the
+  // lock, if the node changed since version was read.
+  void upgrade_to_write_lock_or_restart(std::uint64_t &version, bool &restart) {
+    if (lock_.lock() != 0) {
+      restart = true;
+      return;
+    }
+    if (version_.load(std::memory_order_relaxed) != version) {
+      lock_.unlock();
+      restart = true;
+      return;
+    }
+    version += kLocked;
+    version_.store(version, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  // Releases the write lock, publishing a new version.
+  void write_unlock() {
+    version_.store(version_.load(std::memory_order_relaxed) + kLocked,
+                   std::memory_order_release);
+    lock_.unlock();
+  }
+
+  // Pessimistic shared access, excluding writers.
+  void lock_shared() const { lock_.lock_shared(); }
+  void unlock_shared() const { lock_.unlock(); }
+
+private:
+  static constexpr std::uint64_t kLocked = 0b10;
+
+  static bool is_locked(std::uint64_t version) {
+    return (version & kLocked) != 0;
+  }
+
+  std::atomic<std::uint64_t> version_{0b100};
+  mutable RWLock lock_;
+};
+
+// Concurrent in-memory B+tree using optimistic lock coupling (Leis et al.).
+// Lookups take no locks: they read each node's version, read the node and
+// validate the version, restarting from the root on conflict. Writers lock
+// only the nodes they modify, splitting full inner nodes on the way down so a
+// split never propagates more than one level. After kMaxOptimisticRestarts a
+// lookup falls back to shared lock coupling on the nodes' RWLocks.
+//
+// Optimistic readers copy keys and values out of nodes that may be changing
+// underneath them, so K and V must be trivially copyable. Erased entries
+// leave nodes underfull; nodes are never merged or freed before the tree is
+// destroyed, which is what lets readers follow stale child pointers safely.
+template <class K, class V, std::size_t kFanout = 64> class BTree {
+  static_assert(std::is_trivially_copyable_v<K> &&
+                    std::is_trivially_copyable_v<V>,
+                "Optimistic readers copy K and V without locks");
+  static_assert(kFanout >= 4, "Nodes must hold at least 4 entries");
+
+public:
+  static constexpr int kMaxOptimisticRestarts = 8;
+
+  BTree() : root_(new Leaf()) {}
+
+  ~BTree() { destroy(root_.load(std::memory_order_relaxed)); }
+
+  // Returns the value stored for key, if any. Takes no locks unless it keeps
+  // conflicting with writers.
+  std::optional<V> lookup(const K &key) const {
+    for (int attempt = 0; attempt < kMaxOptimisticRestarts; ++attempt) {
+      bool restart = false;
+      std::optional<V> result = lookup_optimistic(key, restart);
+      if (!restart) {
+        return result;
+      }
+    }
+    return lookup_pessimistic(key);
+  }
+
+  // Inserts key -> value, or overwrites the value if key is present.
+  void insert(const K &key, const V &value) {
+    while (!try_insert(key, value)) {
+    }
+  }
+
+  // Removes key. Returns true if it was present.
+  bool erase(const K &key) {
+    for (;;) {
+      bool restart = false;
+      bool erased = try_erase(key, restart);
+      if (!restart) {
+        return erased;
+      }
+    }
+  }
+
+  // Disallow move.
+  BTree(BTree &&other) = delete;
+  BTree &operator=(BTree &&other) = delete;
+
+  // Disallow copy.
+  BTree(const BTree &) = delete;
+  BTree &operator=(const BTree &) = delete;
+
+private:
+  struct Node {
+    explicit Node(bool leaf) : is_leaf(leaf) {}
+    VersionedLatch latch;
+    const bool is_leaf;
+    std::uint16_t count = 0;
+  };
+
+  struct Leaf : Node {
+    Leaf() : Node(true) {}
+
+    bool is_full() const { return this->count == kFanout; }
+
+    // First position whose key is >= key.
+    std::size_t lower_bound(const K &key) const {
+      std::size_t lo = 0, hi = this->count;
+      while (lo < hi) {
+        std::size_t mid = (lo + hi) / 2;
+        if (keys[mid] < key) {
+          lo = mid + 1;
+        } else {
+          hi = mid;
+        }
+      }
+      return lo;
+    }
+
+    void insert(const K &key, const V &value) {
+      std::size_t pos = lower_bound(key);
+      if (pos < this->count && !(key < keys[pos])) {
+        values[pos] = value;
+        return;
+      }
+      for (std::size_t i = this->count; i > pos; --i) {
+        keys[i] = keys[i - 1];
+        values[i] = values[i - 1];
+      }
+      keys[pos] = key;
+      values[pos] = value;
+      ++this->count;
+    }
+
+    bool erase(const K &key) {
+      std::size_t pos = lower_bound(key);
+      if (pos == this->count || key < keys[pos]) {
+        return false;
+      }
+      for (std::size_t i = pos + 1; i < this->count; ++i) {
+        keys[i - 1] = keys[i];
+        values[i - 1] = values[i];
+      }
+      --this->count;
+      return true;
+    }
+
+    // Moves the upper half into a new leaf. separator is the largest key left
+    // in this leaf.
+    Leaf *split(K &separator) {
+      Leaf *right = new Leaf();
+      right->count = this->count - this->count / 2;
+      this->count = this->count - right->count;
+      for (std::size_t i = 0; i < right->count; ++i) {
+        right->keys[i] = keys[this->count + i];
+        right->values[i] = values[this->count + i];
+      }
+      separator = keys[this->count - 1];
+      return right;
+    }
+
+    K keys[kFanout];
+    V values[kFanout];
+  };
+
+  // keys[i] is the largest key in children[i]; children[count] holds the
+  // rest.
+  struct Inner : Node {
+    Inner() : Node(false) {}
+
+    bool is_full() const { return this->count == kFanout - 1; }
+
+    std::size_t lower_bound(const K &key) const {
+      std::size_t lo = 0, hi = this->count;
+      while (lo < hi) {
+        std::size_t mid = (lo + hi) / 2;
+        if (keys[mid] < key) {
+          lo = mid + 1;
+        } else {
+          hi = mid;
+        }
+      }
+      return lo;
+    }
+
+    // Inserts the right half of a split child, with the separator between it
+    // and the left half.
+    void insert(const K &separator, Node *right) {
+      std::size_t pos = lower_bound(separator);
+      for (std::size_t i = this->count + 1; i > pos + 1; --i) {
+        children[i] = children[i - 1];
+      }
+      for (std::size_t i = this->count; i > pos; --i) {
+        keys[i] = keys[i - 1];
+      }
+      keys[pos] = separator;
+      children[pos + 1] = right;
+      ++this->count;
+    }
+
+    // Moves the upper half into a new inner node. separator moves up to the
+    // parent.
+    Inner *split(K &separator) {
+      Inner *right = new Inner();
+      right->count = this->count - this->count / 2;
+      this->count = this->count - right->count - 1;
+      separator = keys[this->count];
+      for (std::size_t i = 0; i < right->count; ++i) {
+        right->keys[i] = keys[this->count + 1 + i];
+      }
+      for (std::size_t i = 0; i <= right->count; ++i) {
+        right->children[i] = children[this->count + 1 + i];
+      }
+      return right;
+    }
+
+    K keys[kFanout];
+    Node *children[kFanout];
+  };
+
+  void make_root(const K &separator, Node *left, Node *right) {
+    Inner *root = new Inner();
+    root->count = 1;
+    root->keys[0] = separator;
+    root->children[0] = left;
+    root->children[1] = right;
+    root_.store(root, std::memory_order_release);
+  }
+
+  std::optional<V> lookup_optimistic(const K &key, bool &restart) const {
+    Node *node = root_.load(std::memory_order_acquire);
+    std::uint64_t version = node->latch.read_lock_or_restart(restart);
+    if (restart || node != root_.load(std::memory_order_acquire)) {
+      restart = true;
+      return std::nullopt;
+    }
+    while (!node->is_leaf) {
+      const Inner *inner = static_cast<const Inner *>(node);
+      Node *child = inner->children[inner->lower_bound(key)];
+      inner->latch.check_or_restart(version, restart);
+      if (restart) {
+        return std::nullopt;
+      }
+      node = child;
+      version = node->latch.read_lock_or_restart(restart);
+      if (restart) {
+        return std::nullopt;
+      }
+    }
+    const Leaf *leaf = static_cast<const Leaf *>(node);
+    std::size_t pos = leaf->lower_bound(key);
+    std::optional<V> result;
+    if (pos < leaf->count && !(key < leaf->keys[pos])) {
+      result = leaf->values[pos];
+    }
+    leaf->latch.read_unlock_or_restart(version, restart);
+    return result;
+  }
+
+  // Shared lock coupling from the root. Blocks writers on the visited path.
+  std::optional<V> lookup_pessimistic(const K &key) const {
+    Node *node;
+    for (;;) {
+      node = root_.load(std::memory_order_acquire);
+      node->latch.lock_shared();
+      // The root can only be replaced while it is write-locked.
+      if (node == root_.load(std::memory_order_acquire)) {
+        break;
+      }
+      node->latch.unlock_shared();
+    }
+    while (!node->is_leaf) {
+      const Inner *inner = static_cast<const Inner *>(node);
+      Node *child = inner->children[inner->lower_bound(key)];
+      child->latch.lock_shared();
+      node->latch.unlock_shared();
+      node = child;
+    }
+    const Leaf *leaf = static_cast<const Leaf *>(node);
+    std::size_t pos = leaf->lower_bound(key);
+    std::optional<V> result;
+    if (pos < leaf->count && !(key < leaf->keys[pos])) {
+      result = leaf->values[pos];
+    }
+    leaf->latch.unlock_shared();
+    return result;
+  }
+
+  // One optimistic insert attempt. Returns false if it must be retried.
+  bool try_insert(const K &key, const V &value) {
+    bool restart = false;
+    Node *node = root_.load(std::memory_order_acquire);
+    std::uint64_t version = node->latch.read_lock_or_restart(restart);
+    if (restart || node != root_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    Inner *parent = nullptr;
+    std::uint64_t parent_version = 0;
+
+    while (!node->is_leaf) {
+      Inner *inner = static_cast<Inner *>(node);
+      if (inner->is_full()) {
+        split_node(inner, version, parent, parent_version);
+        return false;
+      }
+      if (parent != nullptr) {
+        parent->latch.read_unlock_or_restart(parent_version, restart);
+        if (restart) {
+          return false;
+        }
+      }
+      parent = inner;
+      parent_version = version;
+      node = inner->children[inner->lower_bound(key)];
+      inner->latch.check_or_restart(version, restart);
+      if (restart) {
+        return false;
+      }
+      version = node->latch.read_lock_or_restart(restart);
+      if (restart) {
+        return false;
+      }
+    }
+
+    Leaf *leaf = static_cast<Leaf *>(node);
+    if (leaf->is_full()) {
+      split_node(leaf, version, parent, parent_version);
+      return false;
+    }
+    leaf->latch.upgrade_to_write_lock_or_restart(version, restart);
+    if (restart) {
+      return false;
+    }
+    if (parent != nullptr) {
+      parent->latch.read_unlock_or_restart(parent_version, restart);
+      if (restart) {
+        leaf->latch.write_unlock();
+        return false;
+      }
+    }
+    leaf->insert(key, value);
+    leaf->latch.write_unlock();
+    return true;
+  }
+
+  // Splits a full node read at version, inserting the new sibling into parent
+  // (or a new root). Locks parent before node, i.e. top-down like every other
+  // path, so writers cannot deadlock. The caller restarts either way.
+  template <class N>
+  void split_node(N *node, std::uint64_t version, Inner *parent,
+                  std::uint64_t parent_version) {
+    bool restart = false;
+    if (parent != nullptr) {
+      parent->latch.upgrade_to_write_lock_or_restart(parent_version, restart);
+      if (restart) {
+        return;
+      }
+    }
+    node->latch.upgrade_to_write_lock_or_restart(version, restart);
+    if (restart) {
+      if (parent != nullptr) {
+        parent->latch.write_unlock();
+      }
+      return;
+    }
+    if (parent == nullptr && node != root_.load(std::memory_order_relaxed)) {
+      node->latch.write_unlock();
+      return;
+    }
+    K separator;
+    Node *right = node->split(separator);
+    if (parent != nullptr) {
+      parent->insert(separator, right);
+    } else {
+      make_root(separator, node, right);
+    }
+    node->latch.write_unlock();
+    if (parent != nullptr) {
+      parent->latch.write_unlock();
+    }
+  }
+
+  bool try_erase(const K &key, bool &restart) {
+    Node *node = root_.load(std::memory_order_acquire);
+    std::uint64_t version = node->latch.read_lock_or_restart(restart);
+    if (restart || node != root_.load(std::memory_order_acquire)) {
+      restart = true;
+      return false;
+    }
+    Inner *parent = nullptr;
+    std::uint64_t parent_version = 0;
+    while (!node->is_leaf) {
+      Inner *inner = static_cast<Inner *>(node);
+      if (parent != nullptr) {
+        parent->latch.read_unlock_or_restart(parent_version, restart);
+        if (restart) {
+          return false;
+        }
+      }
+      parent = inner;
+      parent_version = version;
+      node = inner->children[inner->lower_bound(key)];
+      inner->latch.check_or_restart(version, restart);
+      if (restart) {
+        return false;
+      }
+      version = node->latch.read_lock_or_restart(restart);
+      if (restart) {
+        return false;
+      }
+    }
+    Leaf *leaf = static_cast<Leaf *>(node);
+    leaf->latch.upgrade_to_write_lock_or_restart(version, restart);
+    if (restart) {
+      return false;
+    }
+    if (parent != nullptr) {
+      parent->latch.read_unlock_or_restart(parent_version, restart);
+      if (restart) {
+        leaf->latch.write_unlock();
+        return false;
+      }
+    }
+    bool erased = leaf->erase(key);
+    leaf->latch.write_unlock();
+    return erased;
+  }
+
+  static void destroy(Node *node) {
+    if (node->is_leaf) {
+      delete static_cast<Leaf *>(node);
+      return;
+    }
+    Inner *inner = static_cast<Inner *>(node);
+    for (std::size_t i = 0; i <= inner->count; ++i) {
+      destroy(inner->children[i]);
+    }
+    delete inner;
+  }
+
+  std::atomic<Node *> root_;
+};
+
+} // namespace rwlock
@@ -0,0 +1,304 @@
+#pragma once
+
+#include "rwlock/rw_lock.h"
+#include "rwlock/shared_lock.h"
+#include "rwlock/sharding.h"
+#include "rwlock/unique_lock.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace rwlock {
+
+// Hash map split into cache-aligned shards, each guarded by its own RWLock and
+// holding an open-addressing (linear probing) table. Lookups take the shard's
+// lock shared, updates take it exclusive, and a shard grows on its own while
+// the others stay available.
+template <class K, class V, class Hash = std::hash<K>,
+          class KeyEqual = std::equal_to<K>>
+class ConcurrentHashMap {
+public:
+  // shard_count is rounded up to a power of two. initial_capacity is the
+  // expected number of entries across all shards.
+  explicit ConcurrentHashMap(std::size_t shard_count = 16,
+                             std::size_t initial_capacity = 0)
+      : shard_bits_(detail::shard_bits(shard_count)),
+        shards_(new Shard[std::size_t(1) << shard_bits_]) {
+    reserve(initial_capacity);
+  }
+
+  // Returns a copy of the value mapped to key, if any. Takes the shard's lock
+  // shared.
+  std::optional<V> find(const K &key) const {
+    const std::uint64_t hash = hash_of(key);
+    const Shard &shard = shard_for(hash);
+    SharedLock guard(shard.lock);
+    const Slot *slot = shard.find(key, hash, equal_);
+    if (slot == nullptr) {
+      return std::nullopt;
+    }
+    return slot->entry->second;
+  }
+
+  // Returns true if key is present. Takes the shard's lock shared.
+  bool contains(const K &key) const {
+    const std::uint64_t hash = hash_of(key);
+    const Shard &shard = shard_for(hash);
+    SharedLock guard(shard.lock);
+    return shard.find(key, hash, equal_) != nullptr;
+  }
+
+  // Inserts key -> value if key is absent. Returns true if inserted. Takes the
+  // shard's lock exclusive.
+  bool insert(const K &key, V value) {
+    return emplace(key, std::move(value), /*assign=*/false);
+  }
+
+  // Inserts key -> value, or overwrites the existing value. Returns true if
+  // inserted. Takes the shard's lock exclusive.
+  bool insert_or_assign(const K &key, V value) {
+    return emplace(key, std::move(value), /*assign=*/true);
+  }
+
+  // Removes key. Returns true if it was present. Takes the shard's lock
+  // exclusive.
+  bool erase(const K &key) {
+    const std::uint64_t hash = hash_of(key);
+    Shard &shard = shard_for(hash);
+    UniqueLock guard(shard.lock);
+    Slot *slot = const_cast<Slot *>(shard.find(key, hash, equal_));
+    if (slot == nullptr) {
+      return false;
+    }
+    slot->entry.reset();
+    slot->deleted = true;
+    --shard.size;
+    ++shard.tombstones;
+    return true;
+  }
+
+  // Number of entries. Each shard is counted under its own lock, so the total
+  // is only a snapshot when there are concurrent updates.
+  std::size_t size() const {
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < shard_count(); ++i) {
+      SharedLock guard(shards_[i].lock);
+      total += shards_[i].size;
+    }
+    return total;
+  }
+
+  class ShardView;
+
+  // Calls f(const ShardView &) once per shard, with that shard's shared lock
+  // held for the whole call, so a bulk read of a shard costs one acquisition.
+  // f must not call back into the map for keys of that shard. The walk is not
+  // a snapshot of the whole map.
+  template <class F> void for_each_shard(F &&f) const {
+    for (std::size_t i = 0; i < shard_count(); ++i) {
+      SharedLock guard(shards_[i].lock);
+      f(ShardView(shards_[i]));
+    }
+  }
+
+  // Calls f(const K &, const V &) for every entry, one shard at a time as
+  // for_each_shard does.
+  template <class F> void for_each(F &&f) const {
+    for_each_shard([&](const ShardView &shard) {
+      for (const std::pair<K, V> &entry : shard) {
+        f(entry.first, entry.second);
+      }
+    });
+  }
+
+  // Grows shards, one at a time, so that capacity entries spread evenly over
+  // them fit without further resizing.
+  void reserve(std::size_t capacity) {
+    const std::size_t per_shard =
+        (capacity + shard_count() - 1) / shard_count();
+    for (std::size_t i = 0; i < shard_count(); ++i) {
+      UniqueLock guard(shards_[i].lock);
+      if (!shards_[i].fits(per_shard)) {
+        shards_[i].rehash(per_shard, hasher_);
+      }
+    }
+  }
+
+  std::size_t shard_count() const { return std::size_t(1) << shard_bits_; }
+
+  // Disallow move.
+  ConcurrentHashMap(ConcurrentHashMap &&other) = delete;
+  ConcurrentHashMap &operator=(ConcurrentHashMap &&other) = delete;
+
+  // Disallow copy.
+  ConcurrentHashMap(const ConcurrentHashMap &) = delete;
+  ConcurrentHashMap &operator=(const ConcurrentHashMap &) = delete;
+
+private:
+  // A slot is empty, full (entry set) or a tombstone (deleted set) that keeps
+  // probe chains intact after an erase.
+  struct Slot {
+    std::optional<std::pair<K, V>> entry;
+    bool deleted = false;
+  };
+
+  struct Shard;
+
+public:
+  // The entries of one shard, as passed to for_each_shard. Only valid during
+  // that call. Iterating yields const std::pair<K, V> &.
+  class ShardView {
+  public:
+    class iterator {
+    public:
+      const std::pair<K, V> &operator*() const { return *it_->entry; }
+      const std::pair<K, V> *operator->() const { return &*it_->entry; }
+
+      iterator &operator++() {
+        ++it_;
+        skip_empty();
+        return *this;
+      }
+
+      bool operator==(const iterator &other) const { return it_ == other.it_; }
+
+    private:
+      friend class ShardView;
+      using SlotIt = typename std::vector<Slot>::const_iterator;
+
+      iterator(SlotIt it, SlotIt end) : it_(it), end_(end) { skip_empty(); }
+
+      void skip_empty() {
+        while (it_ != end_ && !it_->entry) {
+          ++it_;
+        }
+      }
+
+      SlotIt it_;
+      SlotIt end_;
+    };
+
+    iterator begin() const {
+      return iterator(shard_->slots.begin(), shard_->slots.end());
+    }
+    iterator end() const {
+      return iterator(shard_->slots.end(), shard_->slots.end());
+    }
+
+    std::size_t size() const { return shard_->size; }
+    bool empty() const { return shard_->size == 0; }
+
+  private:
+    friend class ConcurrentHashMap;
+
+    explicit ShardView(const Shard &shard) : shard_(&shard) {}
+
+    const Shard *shard_;
+  };
+
+private:
+
+  struct alignas(64) Shard {
+    mutable RWLock lock;
+    std::vector<Slot> slots;
+    std::size_t size = 0;
+    std::size_t tombstones = 0;
+
+    // Maximum load, counting tombstones, is 3/4.
+    bool fits(std::size_t count) const { return count * 4 <= slots.size() * 3; }
+
+    static std::size_t index_of(std::uint64_t hash, std::size_t capacity) {
+      return (hash ^ (hash >> 29)) & (capacity - 1);
+    }
+
+    const Slot *find(const K &key, std::uint64_t hash,
+                     const KeyEqual &equal) const {
+      if (slots.empty()) {
+        return nullptr;
+      }
+      const std::size_t mask = slots.size() - 1;
+      for (std::size_t i = index_of(hash, slots.size());; i = (i + 1) & mask) {
+        const Slot &slot = slots[i];
+        if (slot.entry) {
+          if (equal(slot.entry->first, key)) {
+            return &slot;
+          }
+        } else if (!slot.deleted) {
+          return nullptr;
+        }
+      }
+    }
+
+    // Rebuilds the table with room for count live entries, dropping
+    // tombstones.
+    void rehash(std::size_t count, const Hash &hasher) {
+      std::size_t capacity = 8;
+      while (capacity * 3 < count * 4) {
+        capacity *= 2;
+      }
+      std::vector<Slot> old = std::move(slots);
+      slots = std::vector<Slot>(capacity);
+      tombstones = 0;
+      for (Slot &slot : old) {
+        if (slot.entry) {
+          const std::size_t mask = capacity - 1;
+          std::size_t i = index_of(detail::mix_hash(hasher(slot.entry->first)),
+                                   capacity);
+          while (slots[i].entry) {
+            i = (i + 1) & mask;
+          }
+          slots[i].entry = std::move(slot.entry);
+        }
+      }
+    }
+  };
+
+  // The top bits of the hash pick the shard, the rest the slot.
+  std::uint64_t hash_of(const K &key) const {
+    return detail::mix_hash(hasher_(key));
+  }
+
+  Shard &shard_for(std::uint64_t hash) const {
+    return shards_[detail::shard_index(hash, shard_bits_)];
+  }
+
+  bool emplace(const K &key, V value, bool assign) {
+    const std::uint64_t hash = hash_of(key);
+    Shard &shard = shard_for(hash);
+    UniqueLock guard(shard.lock);
+    Slot *existing = const_cast<Slot *>(shard.find(key, hash, equal_));
+    if (existing != nullptr) {
+      if (assign) {
+        existing->entry->second = std::move(value);
+      }
+      return false;
+    }
+    if (!shard.fits(shard.size + shard.tombstones + 1)) {
+      // Leave room for as many inserts again; drops tombstones as well.
+      shard.rehash(2 * (shard.size + 1), hasher_);
+    }
+    const std::size_t mask = shard.slots.size() - 1;
+    std::size_t i = Shard::index_of(hash, shard.slots.size());
+    while (shard.slots[i].entry) {
+      i = (i + 1) & mask;
+    }
+    if (shard.slots[i].deleted) {
+      shard.slots[i].deleted = false;
+      --shard.tombstones;
+    }
+    shard.slots[i].entry.emplace(key, std::move(value));
+    ++shard.size;
+    return true;
+  }
+
+  const unsigned shard_bits_;
+  std::unique_ptr<Shard[]> shards_;
+  Hash hasher_;
+  KeyEqual equal_;
+};
+
+} // namespace rwlock
@@ -0,0 +1,194 @@
+#pragma once
+
+#include "rwlock/futex.h"
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <concepts>
+#include <condition_variable>
+#include <cerrno>
+#include <cstdint>
+#include <ctime>
+#include <system_error>
+#include <type_traits>
+
+namespace rwlock {
+
+// Engines with a futex word that releases wake one waiter at a time from can
+// take requeued waiters.
+template <class Lock>
+concept RequeueTarget = requires(Lock &lock) {
+  { lock.requeue_word() } -> std::same_as<std::atomic<std::uint32_t> &>;
+  { lock.mark_requeued() } -> std::same_as<bool>;
+};
+
+// Condition variable for the read-write lock guards (SharedLock, UniqueLock
+// and their Basic* templates over any engine). Unlike
+// std::condition_variable_any it has no internal mutex: waiters sleep on a
+// sequence word that every notify bumps.
+//
+// When the engine is a RequeueTarget (e.g. FutexRWLock), notify_all wakes a
+// single waiter and moves the rest onto the lock's requeue word, so they wake
+// one release at a time instead of all stampeding for the lock at once. With
+// other engines (RWLock) notify_all wakes every waiter.
+//
+// A condition variable is bound to the lock of its first wait for the rest of
+// its lifetime; waiting with a guard over another lock throws
+// std::system_error (EINVAL).
+class RWConditionVariable {
+public:
+  RWConditionVariable() = default;
+
+  // Releases the guard's lock, waits for a notify (or a spurious wakeup) and
+  // reacquires the lock in the guard's mode.
+  template <class Guard> void wait(Guard &guard) {
+    const std::uint32_t seq = prepare_wait(guard);
+    guard.unlock();
+    detail::futex_wait(seq_, seq);
+    finish_wait(guard);
+  }
+
+  // Waits until pred() holds. pred is evaluated with the lock held.
+  template <class Guard, class Predicate>
+  void wait(Guard &guard, Predicate pred) {
+    while (!pred()) {
+      wait(guard);
+    }
+  }
+
+  // Like wait(guard), but gives up at timeout_time.
+  template <class Guard, class Clock, class Duration>
+  std::cv_status
+  wait_until(Guard &guard,
+             const std::chrono::time_point<Clock, Duration> &timeout_time) {
+    const struct timespec deadline = detail::to_monotonic(timeout_time);
+    const std::uint32_t seq = prepare_wait(guard);
+    guard.unlock();
+    detail::futex_wait_until(seq_, seq, deadline);
+    finish_wait(guard);
+    return Clock::now() < timeout_time ? std::cv_status::no_timeout
+                                       : std::cv_status::timeout;
+  }
+
+  // Waits until pred() holds or timeout_time is reached. Returns pred().
+  template <class Guard, class Clock, class Duration, class Predicate>
+  bool wait_until(Guard &guard,
+                  const std::chrono::time_point<Clock, Duration> &timeout_time,
+                  Predicate pred) {
+    while (!pred()) {
+      if (wait_until(guard, timeout_time) == std::cv_status::timeout) {
+        return pred();
+      }
+    }
+    return true;
+  }
+
+  template <class Guard, class Rep, class Period>
+  std::cv_status
+  wait_for(Guard &guard,
+           const std::chrono::duration<Rep, Period> &timeout_duration) {
+    return wait_until(guard,
+                      std::chrono::steady_clock::now() + timeout_duration);
+  }
+
+  template <class Guard, class Rep, class Period, class Predicate>
+  bool wait_for(Guard &guard,
+                const std::chrono::duration<Rep, Period> &timeout_duration,
+                Predicate pred) {
+    return wait_until(
+        guard, std::chrono::steady_clock::now() + timeout_duration, pred);
+  }
+
+  // Wakes one waiter.
+  void notify_one() {
+    seq_.fetch_add(1, std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_seq_cst) != 0) {
+      detail::futex_wake(seq_, 1);
+    }
+  }
+
+  // Wakes all waiters, requeueing them onto the lock when the engine allows.
+  void notify_all() {
+    const std::uint32_t seq = seq_.fetch_add(1, std::memory_order_seq_cst) + 1;
+    if (waiters_.load(std::memory_order_seq_cst) == 0) {
+      return;
+    }
+    RequeueFn requeue = requeue_.load(std::memory_order_acquire);
+    if (requeue == nullptr) {
+      detail::futex_wake(seq_);
+      return;
+    }
+    requeue(lock_.load(std::memory_order_acquire), seq_, seq);
+  }
+
+  // Disallow move.
+  RWConditionVariable(RWConditionVariable &&other) = delete;
+  RWConditionVariable &operator=(RWConditionVariable &&other) = delete;
+
+  // Disallow copy.
+  RWConditionVariable(const RWConditionVariable &) = delete;
+  RWConditionVariable &operator=(const RWConditionVariable &) = delete;
+
+private:
+  using RequeueFn = void (*)(void *lock, std::atomic<std::uint32_t> &seq,
+                             std::uint32_t expected);
+
+  // Moves the waiters on seq onto the lock's requeue word. One waiter is
+  // woken outright: if the lock is free nobody would otherwise release it and
+  // wake the next.
+  template <class Lock>
+  static void requeue_onto(void *p, std::atomic<std::uint32_t> &seq,
+                           std::uint32_t expected) {
+    Lock &lock = *static_cast<Lock *>(p);
+    // Flag the lock first so the release that follows the requeue wakes one
+    // of the waiters we move.
+    lock.mark_requeued();
+    while (!detail::futex_requeue(seq, expected, 1, INT_MAX,
+                                  lock.requeue_word())) {
+      // A racing notify bumped seq; requeue against its value.
+      expected = seq.load(std::memory_order_seq_cst);
+    }
+    // A release between the flag and the requeue cleared the flag and may
+    // have found nobody to wake. Wake one of the moved waiters now.
+    if (!lock.mark_requeued()) {
+      detail::futex_wake(lock.requeue_word(), 1);
+    }
+  }
+
+  // Binds the condition variable to the guard's lock, registers the caller as
+  // a waiter and returns the sequence to wait on.
+  template <class Guard> std::uint32_t prepare_wait(Guard &guard) {
+    using Lock = std::remove_pointer_t<decltype(guard.rwlock())>;
+    void *bound = nullptr;
+    if (!lock_.compare_exchange_strong(bound, guard.rwlock(),
+                                       std::memory_order_relaxed) &&
+        bound != guard.rwlock()) {
+      throw std::system_error(EINVAL, std::generic_category(),
+                              "Condition variable is bound to another lock");
+    }
+    if constexpr (RequeueTarget<Lock>) {
+      requeue_.store(&requeue_onto<Lock>, std::memory_order_release);
+    }
+    waiters_.fetch_add(1, std::memory_order_seq_cst);
+    return seq_.load(std::memory_order_seq_cst);
+  }
+
+  template <class Guard> void finish_wait(Guard &guard) {
+    using Lock = std::remove_pointer_t<decltype(guard.rwlock())>;
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+    if constexpr (RequeueTarget<Lock>) {
+      // We may have been requeued, and the release that woke us cleared the
+      // flag. Raise it again so that our own release wakes the next waiter.
+      // At worst this costs one release a wake that finds nobody.
+      guard.rwlock()->mark_requeued();
+    }
+    guard.lock();
+  }
+
+  std::atomic<std::uint32_t> seq_{0};
+  std::atomic<std::uint32_t> waiters_{0};
+  std::atomic<void *> lock_{nullptr};
+  std::atomic<RequeueFn> requeue_{nullptr};
+};
+
+} // namespace rwlock
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "rwlock/multi_lock.h"
+#include "rwlock/shared_lock.h"
+#include "rwlock/unique_lock.h"
+#include "rwlock/wait_queue_rw_lock.h"
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <mutex>
+#include <system_error>
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace rwlock {
+
+// A queued acquisition of a WaitQueueRWLock that signals an eventfd instead of
+// blocking, so an epoll reactor can wait for the lock like any other fd.
+// Construction queues the request (or takes the lock right away, if free);
+// fd() becomes readable once the lock is granted, and take_unique() /
+// take_shared() then hand it over as a normal guard.
+//
+//   EventFdLockRequest request(lock, LockMode::kExclusive);
+//   epoll_ctl(epfd, EPOLL_CTL_ADD, request.fd(), &event); // EPOLLIN
+//   // ... once readable:
+//   BasicUniqueLock<WaitQueueRWLock> guard = request.take_unique();
+//
+// Destroying a request that has not been taken withdraws it, releasing the
+// lock if it had already been granted.
+class EventFdLockRequest {
+public:
+  EventFdLockRequest(WaitQueueRWLock &lock, LockMode mode)
+      : lock_(&lock), waiter_{mode == LockMode::kExclusive, {}} {
+    waiter_.eventfd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (waiter_.eventfd < 0) {
+      throw std::system_error(errno, std::generic_category(),
+                              "EventFdLockRequest: eventfd failed");
+    }
+    if (lock_->acquire_or_enqueue(&waiter_)) {
+      waiter_.slot.resolve(detail::WaitSlot::kGranted);
+      const std::uint64_t one = 1;
+      [[maybe_unused]] ssize_t rc = write(waiter_.eventfd, &one, sizeof(one));
+    }
+  }
+
+  ~EventFdLockRequest() {
+    // Takes the lock's internal mutex, so no grant can still be touching us.
+    lock_->cancel(&waiter_);
+    if (!taken_ && granted()) {
+      waiter_.exclusive ? lock_->unlock() : lock_->unlock_shared();
+    }
+    close(waiter_.eventfd);
+  }
+
+  // The eventfd to poll for readability; readable once the lock is granted.
+  int fd() const noexcept { return waiter_.eventfd; }
+
+  // Returns true if the lock has been granted to this request.
+  bool granted() const noexcept {
+    return waiter_.slot.load(std::memory_order_acquire) ==
+           detail::WaitSlot::kGranted;
+  }
+
+  // Hands over an exclusive lock once granted.
+  BasicUniqueLock<WaitQueueRWLock> take_unique() {
+    check_takeable(/*exclusive=*/true);
+    return BasicUniqueLock<WaitQueueRWLock>(*lock_, std::adopt_lock);
+  }
+
+  // Hands over a shared lock once granted.
+  BasicSharedLock<WaitQueueRWLock> take_shared() {
+    check_takeable(/*exclusive=*/false);
+    return BasicSharedLock<WaitQueueRWLock>(*lock_, std::adopt_lock);
+  }
+
+  // Disallow move.
+  EventFdLockRequest(EventFdLockRequest &&other) = delete;
+  EventFdLockRequest &operator=(EventFdLockRequest &&other) = delete;
+
+  // Disallow copy.
+  EventFdLockRequest(const EventFdLockRequest &) = delete;
+  EventFdLockRequest &operator=(const EventFdLockRequest &) = delete;
+
+private:
+  void check_takeable(bool exclusive) {
+    if (exclusive != waiter_.exclusive) {
+      throw std::system_error(EINVAL, std::generic_category(),
+                              "EventFdLockRequest: wrong lock mode");
+    }
+    if (taken_ || !granted()) {
+      throw std::system_error(EAGAIN, std::generic_category(),
+                              "EventFdLockRequest: lock not granted");
+    }
+    taken_ = true;
+  }
+
+  WaitQueueRWLock *lock_;
+  WaitQueueRWLock::Waiter waiter_;
+  bool taken_ = false;
+};
+
+} // namespace rwlock
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "rwlock/rw_lock.h"
+#include "rwlock/unique_lock.h"
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <thread>
+#include <type_traits>
+
+namespace rwlock {
+
+// Flat-combining write path over an RWLock. Writers publish their update in a
+// per-thread slot; whichever writer gets to combine takes the exclusive lock
+// once, runs every published update in one batch and marks them done. Many
+// small writes then cost one lock handoff instead of one each. Readers keep
+// using SharedLock on the same RWLock. Lock is RWLock or any engine with the
+// same interface.
+template <class Lock> class BasicFlatCombiner {
+public:
+  // Number of publication slots. Threads are spread over them by index;
+  // threads that collide on a busy slot take the lock directly instead.
+  static constexpr std::size_t kSlots = 64;
+
+  explicit BasicFlatCombiner(Lock &rwlock) : lock_(&rwlock) {}
+
+  // Runs f() while the rwlock is held exclusively, possibly on another
+  // writer's thread. Returns once f() has run; rethrows anything it threw.
+  template <class F> void apply(F &&f) {
+    using Fn = std::remove_reference_t<F>;
+    Request request;
+    // Fn keeps f's constness; the const_cast only undoes the one in fn.
+    request.run = [](const void *fn) {
+      (*static_cast<Fn *>(const_cast<void *>(fn)))();
+    };
+    request.fn = std::addressof(f);
+
+    Slot &slot = slots_[this_thread_slot() % kSlots];
+    Request *expected = nullptr;
+    if (!slot.request.compare_exchange_strong(expected, &request,
+                                              std::memory_order_release,
+                                              std::memory_order_relaxed)) {
+      // Slot is in use by another thread mapped onto it.
+      BasicUniqueLock<Lock> guard(*lock_);
+      f();
+      return;
+    }
+
+    while (!request.done.load(std::memory_order_acquire)) {
+      if (!combining_.load(std::memory_order_relaxed) &&
+          !combining_.exchange(true, std::memory_order_acquire)) {
+        try {
+          combine();
+        } catch (...) {
+          // Could not take the lock. Withdraw our request, still combining so
+          // that no other combiner can have picked it up, and let a later
+          // combiner run the rest. If it is gone, an earlier combiner ran it.
+          expected = &request;
+          const bool withdrawn =
+              slot.request.compare_exchange_strong(expected, nullptr);
+          combining_.store(false, std::memory_order_release);
+          if (withdrawn) {
+            throw;
+          }
+          continue;
+        }
+        combining_.store(false, std::memory_order_release);
+      } else {
+        std::this_thread::yield();
+      }
+    }
+    if (request.error) {
+      std::rethrow_exception(request.error);
+    }
+  }
+
+  // Returns the underlying rwlock, for readers.
+  Lock *rwlock() { return lock_; }
+
+  // Disallow move.
+  BasicFlatCombiner(BasicFlatCombiner &&other) = delete;
+  BasicFlatCombiner &operator=(BasicFlatCombiner &&other) = delete;
+
+  // Disallow copy.
+  BasicFlatCombiner(const BasicFlatCombiner &) = delete;
+  BasicFlatCombiner &operator=(const BasicFlatCombiner &) = delete;
+
+private:
+  // A published update. Lives on the submitting writer's stack until done.
+  struct Request {
+    void (*run)(const void *);
+    const void *fn;
+    std::exception_ptr error;
+    std::atomic<bool> done{false};
+  };
+
+  struct alignas(64) Slot {
+    std::atomic<Request *> request{nullptr};
+  };
+
+  // Small dense per-thread index used to pick a slot.
+  static std::size_t this_thread_slot() {
+    static std::atomic<std::size_t> next{0};
+    thread_local std::size_t index =
+        next.fetch_add(1, std::memory_order_relaxed);
+    return index;
+  }
+
+  // Runs every published request under one exclusive acquisition.
+  void combine() {
+    BasicUniqueLock<Lock> guard(*lock_);
+    for (Slot &slot : slots_) {
+      Request *request = slot.request.load(std::memory_order_acquire);
+      if (request == nullptr) {
+        continue;
+      }
+      try {
+        request->run(request->fn);
+      } catch (...) {
+        request->error = std::current_exception();
+      }
+      // Free the slot before signalling: once done is set the request may be
+      // gone and its owner may publish again.
+      slot.request.store(nullptr, std::memory_order_relaxed);
+      request->done.store(true, std::memory_order_release);
+    }
+  }
+
+  Lock *lock_;
+  alignas(64) std::atomic<bool> combining_{false};
+  Slot slots_[kSlots];
+};
+
+using FlatCombiner = BasicFlatCombiner<RWLock>;
+
+} // namespace rwlock
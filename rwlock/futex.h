@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <ctime>
+#include <type_traits>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace rwlock {
+namespace detail {
+
+static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t),
+              "futex words are used through std::atomic<uint32_t>");
+
+// futex2 flags for a private 32-bit word, as taken by futex_waitv and
+// IORING_OP_FUTEX_WAIT. Older headers lack the FUTEX2_* names.
+#ifdef FUTEX2_SIZE_U32
+inline constexpr std::uint32_t kFutex2SizeU32 = FUTEX2_SIZE_U32;
+#else
+inline constexpr std::uint32_t kFutex2SizeU32 = 0x02;
+#endif
+#ifdef FUTEX2_PRIVATE
+inline constexpr std::uint32_t kFutex2Private = FUTEX2_PRIVATE;
+#else
+inline constexpr std::uint32_t kFutex2Private = 128;
+#endif
+
+inline std::uint32_t *futex_addr(const std::atomic<std::uint32_t> &word) {
+  return reinterpret_cast<std::uint32_t *>(
+      const_cast<std::atomic<std::uint32_t> *>(&word));
+}
+
+// Blocks while word == expected, until woken by futex_wake. May return
+// spuriously; callers re-check their condition.
+inline void futex_wait(const std::atomic<std::uint32_t> &word,
+                       std::uint32_t expected) {
+  syscall(SYS_futex, futex_addr(word), FUTEX_WAIT_PRIVATE, expected, nullptr,
+          nullptr, 0);
+}
+
+// Wakes up to count threads blocked in futex_wait on word.
+inline void futex_wake(const std::atomic<std::uint32_t> &word,
+                       int count = INT_MAX) {
+  syscall(SYS_futex, futex_addr(word), FUTEX_WAKE_PRIVATE, count, nullptr,
+          nullptr, 0);
+}
+
+// Like futex_wait, but gives up at the absolute CLOCK_MONOTONIC time
+// deadline. Returns false if it timed out.
+inline bool futex_wait_until(const std::atomic<std::uint32_t> &word,
+                             std::uint32_t expected,
+                             const struct timespec &deadline) {
+  const long rc =
+      syscall(SYS_futex, futex_addr(word), FUTEX_WAIT_BITSET_PRIVATE, expected,
+              &deadline, nullptr, FUTEX_BITSET_MATCH_ANY);
+  return !(rc == -1 && errno == ETIMEDOUT);
+}
+
+// If word == expected, wakes up to wake_count threads blocked on word and
+// moves up to requeue_count of the rest onto target, where they wait as if
+// they had called futex_wait on it. Returns false if word != expected.
+inline bool futex_requeue(const std::atomic<std::uint32_t> &word,
+                          std::uint32_t expected, int wake_count,
+                          int requeue_count,
+                          const std::atomic<std::uint32_t> &target) {
+  // The kernel takes the requeue count in the timeout argument.
+  const long rc = syscall(SYS_futex, futex_addr(word),
+                          FUTEX_CMP_REQUEUE_PRIVATE, wake_count,
+                          static_cast<long>(requeue_count), futex_addr(target),
+                          expected);
+  return !(rc == -1 && errno == EAGAIN);
+}
+
+// Waits on several words at once: blocks while every waiters[i].uaddr still
+// holds waiters[i].val, until one is woken, or until the absolute
+// CLOCK_MONOTONIC deadline if one is given. Returns the index of the woken
+// word, or -1 with errno set (EAGAIN: some word had already changed,
+// ETIMEDOUT: deadline passed).
+inline int futex_waitv(struct futex_waitv *waiters, unsigned int count,
+                       const struct timespec *deadline = nullptr) {
+  return static_cast<int>(syscall(SYS_futex_waitv, waiters, count, 0,
+                                  deadline, CLOCK_MONOTONIC));
+}
+
+// Converts a deadline on any clock to an absolute CLOCK_MONOTONIC time,
+// which is what steady_clock reads on Linux.
+template <class Clock, class Duration>
+struct timespec
+to_monotonic(const std::chrono::time_point<Clock, Duration> &timeout_time) {
+  std::chrono::steady_clock::time_point steady;
+  if constexpr (std::is_same_v<Clock, std::chrono::steady_clock>) {
+    steady =
+        std::chrono::time_point_cast<std::chrono::steady_clock::duration>(
+            timeout_time);
+  } else {
+    steady = std::chrono::steady_clock::now() +
+             std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                 timeout_time - Clock::now());
+  }
+  const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      steady.time_since_epoch())
+                      .count();
+  struct timespec ts;
+  ts.tv_sec = ns < 0 ? 0 : ns / 1000000000;
+  ts.tv_nsec = ns < 0 ? 0 : ns % 1000000000;
+  return ts;
+}
+
+} // namespace detail
+} // namespace rwlock
@@ -0,0 +1,288 @@
+#pragma once
+
+#include "rwlock/futex.h"
+#include "rwlock/wait_strategy.h"
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <stop_token>
+
+namespace rwlock {
+
+// Read-write lock on a single 32-bit futex word, with waiting delegated to a
+// wait strategy (see wait_strategy.h). Writer preferring: once a writer
+// waits, new readers hold off until it is done.
+// Does not detect a thread re-locking a lock it already holds. The blocking
+// calls take an optional std::stop_token to give up early.
+//
+// State word layout:
+//   bit 31      writer holds the lock
+//   bit 30      some thread may be parked on the word; releases must wake
+//   bit 29      condition variable waiters may be requeued onto the lock
+//   bits 20-28  number of waiting writers (saturates at 511)
+//   bits 0-19   number of readers holding the lock
+template <class Wait = DefaultWait> class BasicFutexRWLock {
+public:
+  BasicFutexRWLock() = default;
+
+  // Acquire write lock (exclusive). Blocking.
+  int lock() {
+    std::uint32_t s = 0;
+    if (state_.compare_exchange_strong(s, kWriter, std::memory_order_acquire,
+                                       std::memory_order_relaxed)) {
+      return 0;
+    }
+    return lock_slow(s, nullptr);
+  }
+
+  // Acquire write lock (exclusive). Blocking until acquired or stop is
+  // requested. If rc == ECANCELED, stop was requested and the lock was not
+  // taken.
+  int lock(std::stop_token stop) {
+    if (stop.stop_requested()) {
+      return ECANCELED;
+    }
+    std::uint32_t s = 0;
+    if (state_.compare_exchange_strong(s, kWriter, std::memory_order_acquire,
+                                       std::memory_order_relaxed)) {
+      return 0;
+    }
+    std::stop_callback on_stop(stop, [this] { interrupt(); });
+    return lock_slow(s, &stop);
+  }
+
+  // Acquire write lock (exclusive). Non-blocking.
+  // If rc == EBUSY, lock is held for reading or writing.
+  int try_lock() {
+    std::uint32_t s = state_.load(std::memory_order_relaxed);
+    while ((s & (kWriter | kReaderMask)) == 0) {
+      if (state_.compare_exchange_weak(s, s | kWriter,
+                                       std::memory_order_acquire,
+                                       std::memory_order_relaxed)) {
+        return 0;
+      }
+    }
+    return EBUSY;
+  }
+
+  // Acquire read lock (shared). Blocking.
+  // If rc == EAGAIN, the maximum number of readers has been reached.
+  int lock_shared() { return lock_shared_slow(nullptr); }
+
+  // Acquire read lock (shared). Blocking until acquired or stop is requested.
+  // If rc == ECANCELED, stop was requested and the lock was not taken.
+  // If rc == EAGAIN, the maximum number of readers has been reached.
+  int lock_shared(std::stop_token stop) {
+    if (stop.stop_requested()) {
+      return ECANCELED;
+    }
+    std::stop_callback on_stop(stop, [this] { interrupt(); });
+    return lock_shared_slow(&stop);
+  }
+
+  // Acquire read lock (shared). Non-blocking.
+  // If rc == EBUSY, a writer holds or is waiting for the lock.
+  // If rc == EAGAIN, the maximum number of readers has been reached.
+  int try_lock_shared() {
+    std::uint32_t s = state_.load(std::memory_order_relaxed);
+    for (;;) {
+      if ((s & (kWriter | kWaitingWriterMask)) != 0) {
+        return EBUSY;
+      }
+      if ((s & kReaderMask) == kReaderMask) {
+        return EAGAIN;
+      }
+      if (state_.compare_exchange_weak(s, s + 1, std::memory_order_acquire,
+                                       std::memory_order_relaxed)) {
+        return 0;
+      }
+    }
+  }
+
+  // Unlock from either a read or a write lock. Returns false if the lock was
+  // not held.
+  bool unlock() {
+    // Only the writer can clear the writer bit, and readers cannot hold the
+    // lock while it is set, so seeing it here means we are the writer.
+    if ((state_.load(std::memory_order_relaxed) & kWriter) == 0) {
+      return unlock_shared();
+    }
+    const std::uint32_t s = state_.fetch_and(~(kWriter | kParked | kRequeued),
+                                             std::memory_order_release);
+    if ((s & (kParked | kRequeued)) != 0) {
+      wake(s);
+    }
+    return true;
+  }
+
+  // Unlock a read lock. Returns false if no read lock was held.
+  bool unlock_shared() {
+    std::uint32_t s = state_.load(std::memory_order_relaxed);
+    for (;;) {
+      if ((s & kReaderMask) == 0) {
+        return false;
+      }
+      std::uint32_t next = s - 1;
+      // Only the last reader can let anyone parked make progress.
+      const bool last = (next & kReaderMask) == 0;
+      if (last) {
+        next &= ~(kParked | kRequeued);
+      }
+      if (state_.compare_exchange_weak(s, next, std::memory_order_release,
+                                       std::memory_order_relaxed)) {
+        if (last && (s & (kParked | kRequeued)) != 0) {
+          wake(s);
+        }
+        return true;
+      }
+    }
+  }
+
+  // The futex word threads park on. Lets callers wait on the lock outside its
+  // own calls (see acquire_any.h and uring_lock.h).
+  std::atomic<std::uint32_t> &futex_word() { return state_; }
+
+  // The word RWConditionVariable requeues its waiters onto instead of waking
+  // them (see condition_variable.h). Unlike threads parked on futex_word(),
+  // which every release wakes, each release wakes at most one of these.
+  std::atomic<std::uint32_t> &requeue_word() { return requeued_; }
+
+  // Makes the next release wake a thread requeued onto requeue_word().
+  // Returns true if that was already the case. A requeued thread calls this
+  // once woken, before reacquiring the lock, in case others remain queued.
+  bool mark_requeued() {
+    return (state_.fetch_or(kRequeued, std::memory_order_relaxed) &
+            kRequeued) != 0;
+  }
+
+  // For threads that wait on futex_word() outside the lock's own calls, e.g.
+  // through io_uring (see uring_lock.h). Makes the next release wake parked
+  // threads and returns the word's value to wait on. Retry the acquisition
+  // before waiting: the lock may have been released in the meantime.
+  std::uint32_t prepare_park() {
+    return state_.fetch_or(kParked, std::memory_order_acquire) | kParked;
+  }
+
+  // Disallow move.
+  BasicFutexRWLock(BasicFutexRWLock &&other) = delete;
+  BasicFutexRWLock &operator=(BasicFutexRWLock &&other) = delete;
+
+  // Disallow copy.
+  BasicFutexRWLock(const BasicFutexRWLock &) = delete;
+  BasicFutexRWLock &operator=(const BasicFutexRWLock &) = delete;
+
+private:
+  static constexpr std::uint32_t kWriter = 1u << 31;
+  static constexpr std::uint32_t kParked = 1u << 30;
+  static constexpr std::uint32_t kRequeued = 1u << 29;
+  static constexpr std::uint32_t kOneWaitingWriter = 1u << 20;
+  static constexpr std::uint32_t kWaitingWriterMask = 0x1ffu << 20;
+  static constexpr std::uint32_t kReaderMask = kOneWaitingWriter - 1;
+
+  int lock_slow(std::uint32_t s, const std::stop_token *stop) {
+    Wait wait;
+    bool announced = false;
+    for (;;) {
+      if ((s & (kWriter | kReaderMask)) == 0) {
+        const std::uint32_t next =
+            (s | kWriter) - (announced ? kOneWaitingWriter : 0);
+        if (state_.compare_exchange_weak(s, next, std::memory_order_acquire,
+                                         std::memory_order_relaxed)) {
+          return 0;
+        }
+        continue;
+      }
+      if (stop != nullptr && stop->stop_requested()) {
+        if (announced) {
+          // Readers held off by us may be parked.
+          s = state_.fetch_sub(kOneWaitingWriter, std::memory_order_relaxed);
+          if ((s & kParked) != 0) {
+            detail::futex_wake(state_);
+          }
+        }
+        return ECANCELED;
+      }
+      if (!announced && (s & kWaitingWriterMask) != kWaitingWriterMask) {
+        // Announce ourselves so that new readers hold off.
+        if (!state_.compare_exchange_weak(s, s + kOneWaitingWriter,
+                                          std::memory_order_relaxed)) {
+          continue;
+        }
+        s += kOneWaitingWriter;
+        announced = true;
+      }
+      s = park(wait, s, stop);
+    }
+  }
+
+  int lock_shared_slow(const std::stop_token *stop) {
+    std::uint32_t s = state_.load(std::memory_order_relaxed);
+    Wait wait;
+    for (;;) {
+      if ((s & (kWriter | kWaitingWriterMask)) == 0) {
+        if ((s & kReaderMask) == kReaderMask) {
+          return EAGAIN;
+        }
+        if (state_.compare_exchange_weak(s, s + 1, std::memory_order_acquire,
+                                         std::memory_order_relaxed)) {
+          return 0;
+        }
+        continue;
+      }
+      if (stop != nullptr && stop->stop_requested()) {
+        return ECANCELED;
+      }
+      s = park(wait, s, stop);
+    }
+  }
+
+  // Waits once for the state to move on from s. Before a wait that may park,
+  // sets kParked so the next release issues a wake. Returns the new state.
+  std::uint32_t park(Wait &wait, std::uint32_t s, const std::stop_token *stop) {
+    // With a stop token the CAS runs even if kParked is already set, so that
+    // it synchronizes with any interrupt() before it.
+    if (wait.will_park() && ((s & kParked) == 0 || stop != nullptr)) {
+      if (!state_.compare_exchange_weak(s, s | kParked,
+                                        std::memory_order_acquire,
+                                        std::memory_order_relaxed)) {
+        return s;
+      }
+      s |= kParked;
+    }
+    // A stop requested before the CAS found nothing to wake; catch it here.
+    // One requested after it clears kParked, so the wait cannot block.
+    if (stop != nullptr && stop->stop_requested()) {
+      return s;
+    }
+    wait.wait(state_, s);
+    return state_.load(std::memory_order_relaxed);
+  }
+
+  // Called by a release that cleared kParked and kRequeued from s. Wakes
+  // every parked thread, but only the first requeued one: the rest stay
+  // queued for later releases. The requeued thread re-flags the lock with
+  // mark_requeued() before it reacquires it.
+  void wake(std::uint32_t s) {
+    if ((s & kParked) != 0) {
+      detail::futex_wake(state_);
+    }
+    if ((s & kRequeued) != 0) {
+      detail::futex_wake(requeued_, 1);
+    }
+  }
+
+  // Stop callback: kicks every parked thread so a cancelled one notices. The
+  // others find their condition unchanged and park again.
+  void interrupt() {
+    state_.fetch_and(~kParked, std::memory_order_release);
+    detail::futex_wake(state_);
+  }
+
+  std::atomic<std::uint32_t> state_{0};
+  // Only its address matters: requeued waiters sleep here.
+  std::atomic<std::uint32_t> requeued_{0};
+};
+
+using FutexRWLock = BasicFutexRWLock<>;
+
+} // namespace rwlock
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "rwlock/rw_lock.h"
+#include "rwlock/unique_lock.h"
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <future>
+#include <utility>
+
+namespace rwlock {
+
+// Group-commit write path over an RWLock. Writers push update records onto a
+// lock-free stack and get a future back. The writer whose record lands on an
+// empty stack becomes the leader: it takes the exclusive lock once, applies
+// every record queued by then in submission order, releases the lock and
+// completes their futures. Records submitted while a leader works form the
+// next batch, so write throughput grows with batch size rather than being
+// capped at one lock handoff per update. Readers keep using SharedLock on the
+// same RWLock. Lock is RWLock or any engine with the same interface.
+//
+// Unlike FlatCombiner, followers do not wait: submit() returns as soon as the
+// record is queued, unless the caller is the leader, in which case it returns
+// after applying its batch.
+template <class Lock, class Record,
+          class Apply = std::function<void(Record &)>>
+class BasicGroupCommit {
+public:
+  // apply(record) is called under the exclusive lock, on the leader's thread.
+  BasicGroupCommit(Lock &rwlock, Apply apply)
+      : lock_(&rwlock), apply_(std::move(apply)) {}
+
+  // Queues record. The future becomes ready once it has been applied, and
+  // holds anything apply threw for it.
+  std::future<void> submit(Record record) {
+    Node *node = new Node{std::move(record), {}, {}, nullptr};
+    std::future<void> done = node->done.get_future();
+    Node *head = head_.load(std::memory_order_relaxed);
+    do {
+      node->next = head;
+    } while (!head_.compare_exchange_weak(head, node,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed));
+    if (head == nullptr) {
+      lead();
+    }
+    return done;
+  }
+
+  // Queues record and waits until it has been applied. Rethrows anything
+  // apply threw for it.
+  void commit(Record record) { submit(std::move(record)).get(); }
+
+  // Returns the underlying rwlock, for readers.
+  Lock *rwlock() { return lock_; }
+
+  // Disallow move.
+  BasicGroupCommit(BasicGroupCommit &&other) = delete;
+  BasicGroupCommit &operator=(BasicGroupCommit &&other) = delete;
+
+  // Disallow copy.
+  BasicGroupCommit(const BasicGroupCommit &) = delete;
+  BasicGroupCommit &operator=(const BasicGroupCommit &) = delete;
+
+private:
+  struct Node {
+    Record record;
+    std::promise<void> done;
+    std::exception_ptr error;
+    Node *next = nullptr;
+  };
+
+  // Applies the current batch. Our node is at the bottom of the stack, so it
+  // stays queued until we take the batch; pushes after that see an empty
+  // stack and elect the next leader.
+  void lead() {
+    std::exception_ptr lock_error;
+    try {
+      BasicUniqueLock<Lock> guard(*lock_);
+      // Taking the batch only now lets it grow while we wait for the lock.
+      Node *batch = take_batch();
+      for (Node *n = batch; n != nullptr; n = n->next) {
+        try {
+          apply_(n->record);
+        } catch (...) {
+          n->error = std::current_exception();
+        }
+      }
+      guard.unlock();
+      complete(batch);
+      return;
+    } catch (...) {
+      lock_error = std::current_exception();
+    }
+    // Could not take the lock: fail the whole batch.
+    Node *batch = take_batch();
+    for (Node *n = batch; n != nullptr; n = n->next) {
+      n->error = lock_error;
+    }
+    complete(batch);
+  }
+
+  // Detaches the queued records, oldest first.
+  Node *take_batch() {
+    Node *n = head_.exchange(nullptr, std::memory_order_acquire);
+    Node *batch = nullptr;
+    while (n != nullptr) {
+      Node *next = n->next;
+      n->next = batch;
+      batch = n;
+      n = next;
+    }
+    return batch;
+  }
+
+  static void complete(Node *batch) {
+    while (batch != nullptr) {
+      Node *next = batch->next;
+      if (batch->error) {
+        batch->done.set_exception(batch->error);
+      } else {
+        batch->done.set_value();
+      }
+      delete batch;
+      batch = next;
+    }
+  }
+
+  Lock *lock_;
+  Apply apply_;
+  alignas(64) std::atomic<Node *> head_{nullptr};
+};
+
+template <class Record, class Apply = std::function<void(Record &)>>
+using GroupCommit = BasicGroupCommit<RWLock, Record, Apply>;
+
+} // namespace rwlock
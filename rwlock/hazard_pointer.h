@@ -0,0 +1,314 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace rwlock {
+
+class HazardPointerDomain;
+HazardPointerDomain &default_hazard_pointer_domain();
+
+// Base of every object that can be retired to a HazardPointerDomain. Holds
+// the intrusive link used while the object waits in the retired list.
+class HazardPointerObjectBase {
+protected:
+  HazardPointerObjectBase() = default;
+  HazardPointerObjectBase(const HazardPointerObjectBase &) {}
+  HazardPointerObjectBase &operator=(const HazardPointerObjectBase &) {
+    return *this;
+  }
+  ~HazardPointerObjectBase() = default;
+
+  // identity is the address readers protect, i.e. the most derived T *.
+  void retire_to(HazardPointerDomain &domain, const void *identity,
+                 void (*reclaim)(HazardPointerObjectBase *));
+
+private:
+  friend class HazardPointerDomain;
+  HazardPointerObjectBase *next_retired_ = nullptr;
+  const void *identity_ = nullptr;
+  void (*reclaim_)(HazardPointerObjectBase *) = nullptr;
+};
+
+// Inherit from HazardPointerObject<T> to make T retirable:
+//   struct Node : HazardPointerObject<Node> { ... };
+//   old->retire();  // deleted once no hazard pointer protects it
+// The deleter D is default-constructed at reclamation time.
+template <class T, class D = std::default_delete<T>>
+class HazardPointerObject : public HazardPointerObjectBase {
+public:
+  // Hands the object to domain. It is reclaimed with D once no hazard pointer
+  // of that domain protects it. The object must already be unreachable for
+  // new readers.
+  void retire(HazardPointerDomain &domain = default_hazard_pointer_domain()) {
+    retire_to(domain, static_cast<T *>(this),
+              [](HazardPointerObjectBase *object) {
+                D()(static_cast<T *>(
+                    static_cast<HazardPointerObject *>(object)));
+              });
+  }
+};
+
+// Set of hazard slots and retired objects that are scanned together. Give
+// unrelated data structures their own domain so they do not pay for each
+// other's scans.
+class HazardPointerDomain {
+public:
+  // A scan runs once the retired list holds
+  // max(reclaim_threshold, 2 * hazard slots) objects, so each scan frees at
+  // least half of what it looks at and reclamation is amortized O(1) per
+  // retire.
+  explicit HazardPointerDomain(std::size_t reclaim_threshold = 1000)
+      : reclaim_threshold_(reclaim_threshold) {}
+
+  // No hazard pointers of this domain may be alive. Reclaims everything still
+  // retired.
+  ~HazardPointerDomain() {
+    HazardPointerObjectBase *object = retired_.load(std::memory_order_acquire);
+    while (object != nullptr) {
+      HazardPointerObjectBase *next = object->next_retired_;
+      object->reclaim_(object);
+      object = next;
+    }
+    Record *record = records_.load(std::memory_order_acquire);
+    while (record != nullptr) {
+      Record *next = record->next;
+      delete record;
+      record = next;
+    }
+  }
+
+  // Scans now, reclaiming every retired object that is not protected.
+  void reclaim() { scan(); }
+
+  // Number of retired objects not yet reclaimed.
+  std::size_t retired_count() const {
+    return retired_count_.load(std::memory_order_relaxed);
+  }
+
+  // Disallow move.
+  HazardPointerDomain(HazardPointerDomain &&other) = delete;
+  HazardPointerDomain &operator=(HazardPointerDomain &&other) = delete;
+
+  // Disallow copy.
+  HazardPointerDomain(const HazardPointerDomain &) = delete;
+  HazardPointerDomain &operator=(const HazardPointerDomain &) = delete;
+
+private:
+  friend class HazardPointer;
+  friend class HazardPointerObjectBase;
+
+  // One hazard slot. Records are never freed before the domain, only marked
+  // inactive and reused.
+  struct alignas(64) Record {
+    std::atomic<const void *> hazard{nullptr};
+    std::atomic<bool> active{true};
+    Record *next = nullptr;
+  };
+
+  Record *acquire_record() {
+    for (Record *record = records_.load(std::memory_order_acquire);
+         record != nullptr; record = record->next) {
+      bool expected = false;
+      if (!record->active.load(std::memory_order_relaxed) &&
+          record->active.compare_exchange_strong(expected, true,
+                                                 std::memory_order_acquire)) {
+        return record;
+      }
+    }
+    Record *record = new Record();
+    record->next = records_.load(std::memory_order_relaxed);
+    while (!records_.compare_exchange_weak(record->next, record,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+    }
+    record_count_.fetch_add(1, std::memory_order_relaxed);
+    return record;
+  }
+
+  static void release_record(Record *record) {
+    record->hazard.store(nullptr, std::memory_order_release);
+    record->active.store(false, std::memory_order_release);
+  }
+
+  void push_retired(HazardPointerObjectBase *first,
+                    HazardPointerObjectBase *last, std::size_t count) {
+    // Count first so that a concurrent scan never subtracts more than was
+    // added.
+    retired_count_.fetch_add(count, std::memory_order_relaxed);
+    last->next_retired_ = retired_.load(std::memory_order_relaxed);
+    while (!retired_.compare_exchange_weak(last->next_retired_, first,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+    }
+  }
+
+  void retire(HazardPointerObjectBase *object) {
+    push_retired(object, object, 1);
+    const std::size_t threshold =
+        std::max(reclaim_threshold_,
+                 2 * record_count_.load(std::memory_order_relaxed));
+    if (retired_count_.load(std::memory_order_relaxed) >= threshold) {
+      scan();
+    }
+  }
+
+  // Takes the whole retired list, frees what no slot protects and puts the
+  // rest back.
+  void scan() {
+    HazardPointerObjectBase *object =
+        retired_.exchange(nullptr, std::memory_order_acquire);
+    if (object == nullptr) {
+      return;
+    }
+    // Pairs with the fence in HazardPointer::try_protect: a reader either
+    // published its hazard before this point or will see the object
+    // unlinked when it re-reads the source.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    std::vector<const void *> hazards;
+    for (Record *record = records_.load(std::memory_order_acquire);
+         record != nullptr; record = record->next) {
+      const void *hazard = record->hazard.load(std::memory_order_acquire);
+      if (hazard != nullptr) {
+        hazards.push_back(hazard);
+      }
+    }
+    std::sort(hazards.begin(), hazards.end());
+
+    HazardPointerObjectBase *kept_first = nullptr;
+    HazardPointerObjectBase *kept_last = nullptr;
+    std::size_t taken = 0;
+    std::size_t kept = 0;
+    while (object != nullptr) {
+      HazardPointerObjectBase *next = object->next_retired_;
+      ++taken;
+      if (std::binary_search(hazards.begin(), hazards.end(),
+                             object->identity_)) {
+        object->next_retired_ = kept_first;
+        kept_first = object;
+        if (kept_last == nullptr) {
+          kept_last = object;
+        }
+        ++kept;
+      } else {
+        object->reclaim_(object);
+      }
+      object = next;
+    }
+    retired_count_.fetch_sub(taken, std::memory_order_relaxed);
+    if (kept_first != nullptr) {
+      push_retired(kept_first, kept_last, kept);
+    }
+  }
+
+  const std::size_t reclaim_threshold_;
+  std::atomic<Record *> records_{nullptr};
+  std::atomic<std::size_t> record_count_{0};
+  alignas(64) std::atomic<HazardPointerObjectBase *> retired_{nullptr};
+  std::atomic<std::size_t> retired_count_{0};
+};
+
+// Move-only owner of one hazard slot. Protecting a pointer costs one store
+// and one fence. Acquiring the slot walks the domain's records, so keep a
+// HazardPointer around (e.g. per thread) rather than making one per read.
+class HazardPointer {
+public:
+  // Empty: owns no slot.
+  HazardPointer() = default;
+
+  explicit HazardPointer(HazardPointerDomain &domain)
+      : record_(domain.acquire_record()) {}
+
+  // Returns the current value of src, protected from reclamation until this
+  // hazard pointer is reset, reused or destroyed.
+  template <class T> T *protect(const std::atomic<T *> &src) {
+    T *ptr = src.load(std::memory_order_relaxed);
+    while (!try_protect(ptr, src)) {
+    }
+    return ptr;
+  }
+
+  // Protects ptr, which the caller loaded from src. Returns false, with ptr
+  // updated to src's new value and nothing protected, if src changed.
+  template <class T> bool try_protect(T *&ptr, const std::atomic<T *> &src) {
+    T *expected = ptr;
+    record_->hazard.store(expected, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    ptr = src.load(std::memory_order_acquire);
+    if (ptr != expected) {
+      reset_protection();
+      return false;
+    }
+    return true;
+  }
+
+  // Protects ptr directly. Only safe if ptr is known not to be retired yet.
+  template <class T> void reset_protection(const T *ptr) {
+    record_->hazard.store(ptr, std::memory_order_release);
+  }
+
+  // Stops protecting anything.
+  void reset_protection() {
+    record_->hazard.store(nullptr, std::memory_order_release);
+  }
+
+  // Returns true if this hazard pointer owns no slot.
+  bool empty() const noexcept { return record_ == nullptr; }
+
+  void swap(HazardPointer &other) noexcept { std::swap(record_, other.record_); }
+
+  ~HazardPointer() {
+    if (record_ != nullptr) {
+      HazardPointerDomain::release_record(record_);
+    }
+  }
+
+  HazardPointer(HazardPointer &&other) noexcept : record_(other.record_) {
+    other.record_ = nullptr;
+  }
+
+  HazardPointer &operator=(HazardPointer &&other) noexcept {
+    if (this != &other) {
+      if (record_ != nullptr) {
+        HazardPointerDomain::release_record(record_);
+      }
+      record_ = other.record_;
+      other.record_ = nullptr;
+    }
+    return *this;
+  }
+
+  HazardPointer(const HazardPointer &) = delete;
+  HazardPointer &operator=(const HazardPointer &) = delete;
+
+private:
+  HazardPointerDomain::Record *record_ = nullptr;
+};
+
+// Returns a hazard pointer owning a slot of domain.
+inline HazardPointer
+make_hazard_pointer(HazardPointerDomain &domain = default_hazard_pointer_domain()) {
+  return HazardPointer(domain);
+}
+
+// Domain used when none is given.
+inline HazardPointerDomain &default_hazard_pointer_domain() {
+  static HazardPointerDomain domain;
+  return domain;
+}
+
+inline void
+HazardPointerObjectBase::retire_to(HazardPointerDomain &domain,
+                                   const void *identity,
+                                   void (*reclaim)(HazardPointerObjectBase *)) {
+  identity_ = identity;
+  reclaim_ = reclaim;
+  domain.retire(this);
+}
+
+} // namespace rwlock
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace rwlock {
+
+// Left-Right concurrency control (Ramalhete and Correia). Keeps two instances
+// of T: readers always read the instance the writer is not touching, through
+// a read indicator, and are wait-free. A writer applies its mutation to the
+// other instance, flips readers over to it, waits for readers of the old
+// instance to drain and applies the same mutation again. Costs twice the
+// memory and every write runs twice, so mutations must be deterministic.
+//
+// Use in place of an RWLock-guarded T when reads must never block:
+//   LeftRight<std::map<K, V>> map;
+//   map.read([&](const auto &m) { return m.count(key); });
+//   map.modify([&](auto &m) { m[key] = value; });
+template <class T> class LeftRight {
+public:
+  // Number of reader counters in each read indicator. Readers are spread over
+  // them by thread to keep arrive/depart off a single cache line.
+  static constexpr std::size_t kReadIndicatorSlots = 32;
+
+  // Constructs both instances from args.
+  template <class... Args>
+  explicit LeftRight(const Args &...args)
+      : instances_{T(args...), T(args...)} {}
+
+  // Calls f(const T &) and returns its result. Wait-free: never blocks on
+  // writers or other readers.
+  template <class F> decltype(auto) read(F &&f) const {
+    const int version = version_index_.load(std::memory_order_seq_cst);
+    indicators_[version].arrive();
+    Departure departure{&indicators_[version]};
+    return std::forward<F>(f)(
+        instances_[left_right_.load(std::memory_order_seq_cst)]);
+  }
+
+  // Applies f(T &) to both instances, one at a time, while readers keep
+  // reading the other. Writers are serialized among themselves.
+  template <class F> void modify(F &&f) {
+    std::lock_guard<std::mutex> guard(writer_mutex_);
+    const int current = left_right_.load(std::memory_order_relaxed);
+    f(instances_[1 - current]);
+    left_right_.store(1 - current, std::memory_order_seq_cst);
+
+    // Toggle the version so that readers who may still see the old instance
+    // are all accounted for in one indicator, then wait for both to drain.
+    const int previous_version = version_index_.load(std::memory_order_relaxed);
+    const int next_version = 1 - previous_version;
+    wait_until_empty(indicators_[next_version]);
+    version_index_.store(next_version, std::memory_order_seq_cst);
+    wait_until_empty(indicators_[previous_version]);
+
+    f(instances_[current]);
+  }
+
+  // Disallow move.
+  LeftRight(LeftRight &&other) = delete;
+  LeftRight &operator=(LeftRight &&other) = delete;
+
+  // Disallow copy.
+  LeftRight(const LeftRight &) = delete;
+  LeftRight &operator=(const LeftRight &) = delete;
+
+private:
+  // Counts readers currently using one version.
+  class ReadIndicator {
+  public:
+    void arrive() {
+      slots_[slot()].count.fetch_add(1, std::memory_order_seq_cst);
+    }
+    void depart() {
+      slots_[slot()].count.fetch_sub(1, std::memory_order_release);
+    }
+    bool empty() const {
+      for (const Slot &s : slots_) {
+        if (s.count.load(std::memory_order_seq_cst) != 0) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+  private:
+    struct alignas(64) Slot {
+      std::atomic<long> count{0};
+    };
+
+    static std::size_t slot() {
+      thread_local std::size_t index =
+          std::hash<std::thread::id>()(std::this_thread::get_id()) %
+          kReadIndicatorSlots;
+      return index;
+    }
+
+    Slot slots_[kReadIndicatorSlots];
+  };
+
+  // Departs from the read indicator when the reader's scope ends, including
+  // when f throws.
+  struct Departure {
+    ReadIndicator *indicator;
+    ~Departure() { indicator->depart(); }
+  };
+
+  static void wait_until_empty(const ReadIndicator &indicator) {
+    while (!indicator.empty()) {
+      std::this_thread::yield();
+    }
+  }
+
+  T instances_[2];
+  alignas(64) std::atomic<int> left_right_{0};
+  alignas(64) std::atomic<int> version_index_{0};
+  mutable ReadIndicator indicators_[2];
+  std::mutex writer_mutex_;
+};
+
+} // namespace rwlock
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace rwlock {
+namespace detail {
+
+// Asymmetric fences built on membarrier(2). The frequent side calls
+// light_barrier(), which only stops the compiler from reordering; the rare
+// side calls heavy_barrier(), which makes the kernel run a full fence on
+// every running thread of the process. Together they order a store before a
+// load on either side, as a pair of seq_cst fences would.
+//
+// Without MEMBARRIER_CMD_PRIVATE_EXPEDITED (Linux < 4.14, or blocked by
+// seccomp) both fall back to seq_cst fences.
+inline bool membarrier_available() {
+  static const bool available =
+      syscall(SYS_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0,
+              0) == 0;
+  return available;
+}
+
+inline void light_barrier() {
+  if (membarrier_available()) {
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+  } else {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+}
+
+inline void heavy_barrier() {
+  if (membarrier_available()) {
+    // Cannot fail once registered.
+    syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0);
+  } else {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+}
+
+} // namespace detail
+} // namespace rwlock
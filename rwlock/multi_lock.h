@@ -0,0 +1,145 @@
+#pragma once
+
+#include "rwlock/rw_lock.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace rwlock {
+
+// How one lock of a multi-lock acquisition is taken.
+enum class LockMode { kShared, kExclusive };
+
+// One lock and the mode to take it in.
+struct LockRequest {
+  RWLock *lock;
+  LockMode mode;
+};
+
+// Shorthands for building requests: lock_all({shared(a), exclusive(b)}).
+inline LockRequest shared(RWLock &lock) { return {&lock, LockMode::kShared}; }
+inline LockRequest exclusive(RWLock &lock) {
+  return {&lock, LockMode::kExclusive};
+}
+
+namespace detail {
+
+// Sorts requests by lock address and merges duplicates (exclusive wins), so
+// that every caller acquires any two locks in the same order.
+inline void order_requests(std::vector<LockRequest> &requests) {
+  std::sort(requests.begin(), requests.end(),
+            [](const LockRequest &a, const LockRequest &b) {
+              return std::less<RWLock *>()(a.lock, b.lock);
+            });
+  std::size_t out = 0;
+  for (std::size_t i = 0; i < requests.size(); ++i) {
+    if (out > 0 && requests[out - 1].lock == requests[i].lock) {
+      if (requests[i].mode == LockMode::kExclusive) {
+        requests[out - 1].mode = LockMode::kExclusive;
+      }
+      continue;
+    }
+    requests[out++] = requests[i];
+  }
+  requests.resize(out);
+}
+
+// Releases the first count requests, in reverse order.
+inline void unlock_requests(const std::vector<LockRequest> &requests,
+                            std::size_t count) {
+  while (count > 0) {
+    requests[--count].lock->unlock();
+  }
+}
+
+} // namespace detail
+
+// Acquires every request (blocking) without deadlock: locks are taken in
+// address order, so two callers can never each hold a lock the other waits
+// for. Only safe against other threads that also go through lock_all /
+// ScopedMultiLock (or otherwise respect address order) for these locks.
+// Returns 0 on success. On failure, returns the first error code (see
+// RWLock::lock / lock_shared) with nothing held.
+// requests is reordered and deduplicated in place; pass it to unlock_all.
+inline int lock_all(std::vector<LockRequest> &requests) {
+  detail::order_requests(requests);
+  for (std::size_t i = 0; i < requests.size(); ++i) {
+    const LockRequest &request = requests[i];
+    int rc = request.mode == LockMode::kExclusive ? request.lock->lock()
+                                                  : request.lock->lock_shared();
+    if (rc != 0) {
+      detail::unlock_requests(requests, i);
+      return rc;
+    }
+  }
+  return 0;
+}
+
+// Non-blocking lock_all. Returns EBUSY, with nothing held, if any lock is
+// unavailable.
+inline int try_lock_all(std::vector<LockRequest> &requests) {
+  detail::order_requests(requests);
+  for (std::size_t i = 0; i < requests.size(); ++i) {
+    const LockRequest &request = requests[i];
+    int rc = request.mode == LockMode::kExclusive
+                 ? request.lock->try_lock()
+                 : request.lock->try_lock_shared();
+    if (rc != 0) {
+      detail::unlock_requests(requests, i);
+      return rc;
+    }
+  }
+  return 0;
+}
+
+// Releases every lock taken by lock_all / try_lock_all.
+inline void unlock_all(const std::vector<LockRequest> &requests) {
+  detail::unlock_requests(requests, requests.size());
+}
+
+// Guard holding several RWLocks, each in its own mode, acquired with lock_all
+// and released together.
+class ScopedMultiLock {
+public:
+  // Acquires all requests (blocking). Throws system error if any lock fails;
+  // nothing is held in that case.
+  explicit ScopedMultiLock(std::initializer_list<LockRequest> requests)
+      : ScopedMultiLock(std::vector<LockRequest>(requests)) {}
+
+  explicit ScopedMultiLock(std::vector<LockRequest> requests)
+      : requests_(std::move(requests)), owns_locks_(false) {
+    int rc = lock_all(requests_);
+    if (rc != 0) {
+      throw std::system_error(rc, std::generic_category(),
+                              "Failed to lock() ScopedMultiLock.");
+    }
+    owns_locks_ = true;
+  }
+
+  // Releases all locks early.
+  void unlock() {
+    if (owns_locks_) {
+      unlock_all(requests_);
+      owns_locks_ = false;
+    }
+  }
+
+  // Returns true if we currently hold all the locks.
+  bool owns_locks() const noexcept { return owns_locks_; }
+
+  ~ScopedMultiLock() { unlock(); }
+
+  ScopedMultiLock(const ScopedMultiLock &) = delete;
+  ScopedMultiLock &operator=(const ScopedMultiLock &) = delete;
+
+private:
+  std::vector<LockRequest> requests_;
+  bool owns_locks_;
+};
+
+} // namespace rwlock
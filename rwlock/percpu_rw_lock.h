@@ -0,0 +1,169 @@
+#pragma once
+
+#include "rwlock/membarrier.h"
+#include "rwlock/rseq.h"
+#include "rwlock/wait_strategy.h"
+#include "rwlock/writer_gate.h"
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <unistd.h>
+
+namespace rwlock {
+
+// Read-write lock for read rates where even one atomic add per acquisition
+// is too much. Each CPU has a pair of counters, read locks taken and read
+// locks released, and readers bump their CPU's counter with a restartable
+// sequence (rseq.h): a plain add, no lock prefix, no shared cache line. The
+// writer sets its flag, runs a membarrier so every reader either sees the
+// flag or has its increment visible, and then waits for the released total
+// to catch up with the taken total. Readers that find the flag set count
+// themselves out again and wait for the writer.
+//
+// Without rseq (non-x86_64, old glibc or kernel) the counters are bumped
+// with atomic adds; without membarrier the readers add a full fence. Either
+// way it stays correct, just slower.
+//
+// Writer preferring. The reader count is not tracked per thread, so
+// unlock_shared() cannot detect a lock that was not held and always returns
+// true; EAGAIN is never returned. Writes are expensive (a membarrier plus a
+// scan of every CPU's counters).
+template <class Wait = SpinThen<128, SleepWait<>>> class BasicPerCpuRWLock {
+public:
+  BasicPerCpuRWLock()
+      : cpus_(possible_cpus()), counters_(std::make_unique<Counters[]>(cpus_)) {
+    detail::membarrier_available(); // Register early, off the read path.
+  }
+
+  // Acquire write lock (exclusive). Blocking.
+  // If rc == EDEADLK, the calling thread already holds the write lock.
+  int lock() {
+    const int rc = gate_.lock();
+    if (rc != 0) {
+      return rc;
+    }
+    detail::heavy_barrier();
+    Wait wait;
+    while (!readers_drained()) {
+      wait.pause();
+    }
+    return 0;
+  }
+
+  // Acquire write lock (exclusive). Non-blocking.
+  // If rc == EBUSY, lock is held for reading or writing.
+  int try_lock() {
+    const int rc = gate_.try_lock();
+    if (rc != 0) {
+      return rc;
+    }
+    detail::heavy_barrier();
+    if (!readers_drained()) {
+      gate_.unlock();
+      return EBUSY;
+    }
+    return 0;
+  }
+
+  // Acquire read lock (shared). Blocking.
+  int lock_shared() {
+    for (;;) {
+      const std::uint32_t w = arrive();
+      if (w == kFree) {
+        return 0;
+      }
+      depart();
+      gate_.park(w);
+    }
+  }
+
+  // Acquire read lock (shared). Non-blocking.
+  // If rc == EBUSY, a writer holds or is waiting for the lock.
+  int try_lock_shared() {
+    if (gate_.state(std::memory_order_relaxed) != kFree) {
+      return EBUSY;
+    }
+    if (arrive() != kFree) {
+      depart();
+      return EBUSY;
+    }
+    return 0;
+  }
+
+  // Unlock from either a read or a write lock.
+  bool unlock() {
+    if (gate_.unlock()) {
+      return true;
+    }
+    return unlock_shared();
+  }
+
+  // Unlock a read lock. Always returns true.
+  bool unlock_shared() {
+    depart();
+    return true;
+  }
+
+  // Disallow move.
+  BasicPerCpuRWLock(BasicPerCpuRWLock &&other) = delete;
+  BasicPerCpuRWLock &operator=(BasicPerCpuRWLock &&other) = delete;
+
+  // Disallow copy.
+  BasicPerCpuRWLock(const BasicPerCpuRWLock &) = delete;
+  BasicPerCpuRWLock &operator=(const BasicPerCpuRWLock &) = delete;
+
+private:
+  static constexpr std::uint32_t kFree = detail::WriterGate::kFree;
+
+  // One CPU's counters, on a cache line of their own. Both only grow, so a
+  // reader that migrates between lock and unlock still balances out.
+  struct alignas(64) Counters {
+    std::atomic<std::int64_t> taken{0};
+    std::atomic<std::int64_t> released{0};
+  };
+
+  static std::size_t possible_cpus() {
+    const long n = sysconf(_SC_NPROCESSORS_CONF);
+    return n > 0 ? static_cast<std::size_t>(n) : 1;
+  }
+
+  // Counts this reader in and returns the writer state it then observed.
+  std::uint32_t arrive() {
+    detail::percpu_add(&counters_[0].taken, sizeof(Counters), cpus_, 1);
+    // Pairs with the writer's heavy_barrier: it sees our increment or we
+    // see its flag.
+    detail::light_barrier();
+    return gate_.state(std::memory_order_acquire);
+  }
+
+  void depart() {
+    detail::percpu_add(&counters_[0].released, sizeof(Counters), cpus_, 1);
+  }
+
+  // True once every read lock visible as taken has been released. Releases
+  // are summed first: each was preceded by its take, so equal sums mean no
+  // reader that counted itself in is still inside.
+  bool readers_drained() const {
+    std::int64_t released = 0;
+    for (std::size_t i = 0; i < cpus_; ++i) {
+      released += counters_[i].released.load(std::memory_order_acquire);
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::int64_t taken = 0;
+    for (std::size_t i = 0; i < cpus_; ++i) {
+      taken += counters_[i].taken.load(std::memory_order_acquire);
+    }
+    return taken == released;
+  }
+
+  const std::size_t cpus_;
+  std::unique_ptr<Counters[]> counters_;
+  alignas(64) detail::WriterGate gate_;
+};
+
+using PerCpuRWLock = BasicPerCpuRWLock<>;
+
+} // namespace rwlock
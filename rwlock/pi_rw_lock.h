@@ -0,0 +1,194 @@
+#pragma once
+
+#include "rwlock/futex.h"
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace rwlock {
+
+// Read-write lock whose exclusive mode is a priority-inheritance futex
+// (FUTEX_LOCK_PI / FUTEX_UNLOCK_PI): while a writer holds the lock, the
+// kernel runs it at the priority of the highest-priority thread blocked on
+// it, so a preempted low-priority writer cannot stall a real-time waiter
+// indefinitely.
+//
+// Readers take a plain counter while no writer is around. Once a writer
+// holds or is draining the lock, new readers queue on the PI futex too, so
+// they boost the writer as well. Readers themselves are not boosted: a writer
+// waits for the readers already inside at their own priority, so keep shared
+// sections short where RT threads write.
+//
+// Two words:
+//   owner_    PI futex word: 0, or the writer's TID plus kernel-managed
+//             FUTEX_WAITERS / FUTEX_OWNER_DIED bits.
+//   readers_  bit 31: a writer holds owner_ and is draining or holding;
+//             bits 0-30: number of readers holding the lock.
+class PIRWLock {
+public:
+  PIRWLock() = default;
+
+  // Acquire write lock (exclusive). Blocking.
+  // If rc == EDEADLK, the calling thread already holds the write lock.
+  int lock() {
+    const int rc = pi_lock();
+    if (rc != 0) {
+      return rc;
+    }
+    std::uint32_t s =
+        readers_.fetch_or(kWriterPending, std::memory_order_acquire) |
+        kWriterPending;
+    while ((s & kReaderMask) != 0) {
+      detail::futex_wait(readers_, s);
+      s = readers_.load(std::memory_order_acquire);
+    }
+    return 0;
+  }
+
+  // Acquire write lock (exclusive). Non-blocking.
+  // If rc == EBUSY, lock is held for reading or writing.
+  int try_lock() {
+    std::uint32_t expected = 0;
+    if (!owner_.compare_exchange_strong(expected, tid(),
+                                        std::memory_order_acquire,
+                                        std::memory_order_relaxed)) {
+      return (expected & FUTEX_TID_MASK) == tid() ? EDEADLK : EBUSY;
+    }
+    expected = 0;
+    if (!readers_.compare_exchange_strong(expected, kWriterPending,
+                                          std::memory_order_acquire,
+                                          std::memory_order_relaxed)) {
+      pi_unlock();
+      return EBUSY;
+    }
+    return 0;
+  }
+
+  // Acquire read lock (shared). Blocking.
+  // If rc == EAGAIN, the maximum number of readers has been reached.
+  int lock_shared() {
+    const int rc = try_lock_shared();
+    if (rc != EBUSY) {
+      return rc;
+    }
+    // A writer is in: queue behind it on the PI futex, boosting it.
+    const int pi_rc = pi_lock();
+    if (pi_rc != 0) {
+      return pi_rc;
+    }
+    std::uint32_t s = readers_.load(std::memory_order_relaxed);
+    int result = 0;
+    if ((s & kReaderMask) == kReaderMask) {
+      result = EAGAIN;
+    } else {
+      readers_.fetch_add(1, std::memory_order_acquire);
+    }
+    pi_unlock();
+    return result;
+  }
+
+  // Acquire read lock (shared). Non-blocking.
+  // If rc == EBUSY, a writer holds or is waiting for the lock.
+  // If rc == EAGAIN, the maximum number of readers has been reached.
+  int try_lock_shared() {
+    std::uint32_t s = readers_.load(std::memory_order_relaxed);
+    for (;;) {
+      if ((s & kWriterPending) != 0) {
+        return EBUSY;
+      }
+      if ((s & kReaderMask) == kReaderMask) {
+        return EAGAIN;
+      }
+      if (readers_.compare_exchange_weak(s, s + 1, std::memory_order_acquire,
+                                         std::memory_order_relaxed)) {
+        return 0;
+      }
+    }
+  }
+
+  // Unlock from either a read or a write lock. Returns false if the lock was
+  // not held.
+  bool unlock() {
+    if ((owner_.load(std::memory_order_relaxed) & FUTEX_TID_MASK) == tid()) {
+      readers_.fetch_and(~kWriterPending, std::memory_order_release);
+      pi_unlock();
+      return true;
+    }
+    return unlock_shared();
+  }
+
+  // Unlock a read lock. Returns false if no read lock was held.
+  bool unlock_shared() {
+    std::uint32_t s = readers_.load(std::memory_order_relaxed);
+    do {
+      if ((s & kReaderMask) == 0) {
+        return false;
+      }
+    } while (!readers_.compare_exchange_weak(s, s - 1,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed));
+    // The last reader out lets a draining writer in.
+    if (s == (kWriterPending | 1)) {
+      detail::futex_wake(readers_);
+    }
+    return true;
+  }
+
+  // Disallow move.
+  PIRWLock(PIRWLock &&other) = delete;
+  PIRWLock &operator=(PIRWLock &&other) = delete;
+
+  // Disallow copy.
+  PIRWLock(const PIRWLock &) = delete;
+  PIRWLock &operator=(const PIRWLock &) = delete;
+
+private:
+  static constexpr std::uint32_t kWriterPending = 1u << 31;
+  static constexpr std::uint32_t kReaderMask = kWriterPending - 1;
+
+  static std::uint32_t tid() {
+    thread_local const std::uint32_t id =
+        static_cast<std::uint32_t>(syscall(SYS_gettid));
+    return id;
+  }
+
+  // Takes owner_, blocking in the kernel (and boosting the owner) if needed.
+  int pi_lock() {
+    std::uint32_t expected = 0;
+    if (owner_.compare_exchange_strong(expected, tid(),
+                                       std::memory_order_acquire,
+                                       std::memory_order_relaxed)) {
+      return 0;
+    }
+    for (;;) {
+      if (syscall(SYS_futex, detail::futex_addr(owner_), FUTEX_LOCK_PI_PRIVATE,
+                  0, nullptr, nullptr, 0) == 0) {
+        return 0;
+      }
+      // EAGAIN: the owner is exiting; EINTR: interrupted. Both retry.
+      if (errno != EAGAIN && errno != EINTR) {
+        return errno;
+      }
+    }
+  }
+
+  void pi_unlock() {
+    std::uint32_t expected = tid();
+    if (owner_.compare_exchange_strong(expected, 0, std::memory_order_release,
+                                       std::memory_order_relaxed)) {
+      return;
+    }
+    // FUTEX_WAITERS is set: the kernel hands owner_ to the top waiter.
+    syscall(SYS_futex, detail::futex_addr(owner_), FUTEX_UNLOCK_PI_PRIVATE, 0,
+            nullptr, nullptr, 0);
+  }
+
+  std::atomic<std::uint32_t> owner_{0};
+  std::atomic<std::uint32_t> readers_{0};
+};
+
+} // namespace rwlock
@@ -0,0 +1,17 @@
+#pragma once
+
+namespace rwlock {
+
+// Service class of a lock request, for engines that order waiters by class
+// (QosRWLock). Lower values are served first.
+enum class QosClass { kInteractive, kNormal, kBatch };
+
+// Engines whose blocking calls take a QosClass. Only guards over these accept
+// one.
+template <class Lock>
+concept QosLock = requires(Lock &lock, QosClass qos) {
+  lock.lock(qos);
+  lock.lock_shared(qos);
+};
+
+} // namespace rwlock
@@ -0,0 +1,195 @@
+#pragma once
+
+#include "rwlock/qos_class.h"
+#include "rwlock/waiter_queue.h"
+#include <cerrno>
+#include <chrono>
+#include <mutex>
+
+namespace rwlock {
+
+// Read-write lock that serves waiters by QoS class instead of arrival order:
+// when the lock frees up it goes to the most urgent queued request, so
+// interactive requests do not queue behind batch scans under load. Pass the
+// class to lock(QosClass) / lock_shared(QosClass), or to the
+// BasicSharedLock / BasicUniqueLock constructors; the plain calls use
+// kNormal.
+//
+// Each waiter is ranked by its arrival time plus its class times aging_step,
+// earliest first. A request of class k thus behaves as if it had arrived k
+// aging steps later: interactive work overtakes a fresh batch request, but a
+// batch request that has waited 2 * aging_step outranks any newcomer, so no
+// class starves.
+//
+// New readers join the readers already inside only if no queued request
+// outranks them; a queued writer holds off less urgent readers.
+class QosRWLock {
+public:
+  explicit QosRWLock(
+      std::chrono::nanoseconds aging_step = std::chrono::milliseconds(10))
+      : aging_step_(aging_step) {}
+
+  // Acquire write lock (exclusive) as a kNormal request. Blocking.
+  int lock() { return lock(QosClass::kNormal); }
+
+  // Acquire write lock (exclusive) as a request of class qos. Blocking.
+  int lock(QosClass qos) { return lock_impl(/*exclusive=*/true, qos); }
+
+  // Acquire write lock (exclusive). Non-blocking. Fails while any request is
+  // queued.
+  // If rc == EBUSY, lock is held for reading or writing.
+  int try_lock() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (state_ != 0 || queued_ != 0) {
+      return EBUSY;
+    }
+    state_ = kWriter;
+    return 0;
+  }
+
+  // Acquire read lock (shared) as a kNormal request. Blocking.
+  int lock_shared() { return lock_shared(QosClass::kNormal); }
+
+  // Acquire read lock (shared) as a request of class qos. Blocking.
+  int lock_shared(QosClass qos) { return lock_impl(/*exclusive=*/false, qos); }
+
+  // Acquire read lock (shared) as a kNormal request. Non-blocking.
+  // If rc == EBUSY, a writer holds the lock or a more urgent request waits.
+  int try_lock_shared() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (!admits(/*exclusive=*/false, rank(QosClass::kNormal))) {
+      return EBUSY;
+    }
+    ++state_;
+    return 0;
+  }
+
+  // Unlock from either a read or a write lock. Returns false if the lock was
+  // not held.
+  bool unlock() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (state_ == 0) {
+      return false;
+    }
+    state_ = state_ == kWriter ? 0 : state_ - 1;
+    if (state_ == 0) {
+      grant_waiters();
+    }
+    return true;
+  }
+
+  // Unlock a read lock. Returns false if no read lock was held.
+  bool unlock_shared() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (state_ <= 0) {
+      return false;
+    }
+    if (--state_ == 0) {
+      grant_waiters();
+    }
+    return true;
+  }
+
+  // Disallow move.
+  QosRWLock(QosRWLock &&other) = delete;
+  QosRWLock &operator=(QosRWLock &&other) = delete;
+
+  // Disallow copy.
+  QosRWLock(const QosRWLock &) = delete;
+  QosRWLock &operator=(const QosRWLock &) = delete;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr int kWriter = -1;
+  static constexpr int kClasses = 3;
+
+  // A queued acquisition, living on the waiting thread's stack.
+  struct Waiter {
+    bool exclusive;
+    Clock::time_point rank;
+    Waiter *prev = nullptr;
+    Waiter *next = nullptr;
+    detail::WaitSlot slot{};
+  };
+
+  // Per-class FIFO. Ranks within a class grow with arrival time, so the head
+  // is always the class's most urgent waiter.
+  using Queue = detail::WaiterQueue<Waiter>;
+
+  Clock::time_point rank(QosClass qos) const {
+    return Clock::now() + static_cast<int>(qos) * aging_step_;
+  }
+
+  int lock_impl(bool exclusive, QosClass qos) {
+    Waiter waiter{exclusive, rank(qos)};
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      if (admits(exclusive, waiter.rank)) {
+        state_ = exclusive ? kWriter : state_ + 1;
+        return 0;
+      }
+      queues_[static_cast<int>(qos)].push_back(&waiter);
+      ++queued_;
+    }
+    waiter.slot.wait();
+    return 0;
+  }
+
+  // Whether a request ranked r may take the lock right now, ahead of the
+  // queue. Called with mutex_ held.
+  bool admits(bool exclusive, Clock::time_point r) const {
+    if (exclusive ? state_ != 0 : state_ == kWriter) {
+      return false;
+    }
+    const Queue *best = most_urgent();
+    return best == nullptr || r < best->front()->rank;
+  }
+
+  Queue *most_urgent() {
+    Queue *best = nullptr;
+    for (Queue &q : queues_) {
+      if (!q.empty() &&
+          (best == nullptr || q.front()->rank < best->front()->rank)) {
+        best = &q;
+      }
+    }
+    return best;
+  }
+
+  const Queue *most_urgent() const {
+    return const_cast<QosRWLock *>(this)->most_urgent();
+  }
+
+  // Hands the now free lock out in rank order: readers until the most urgent
+  // remaining request is a writer, or that writer alone if it comes first.
+  // Called with mutex_ held.
+  void grant_waiters() {
+    Queue *q;
+    while ((q = most_urgent()) != nullptr) {
+      Waiter *w = q->front();
+      if (w->exclusive) {
+        if (state_ != 0) {
+          return; // Waits for the readers just let in.
+        }
+        state_ = kWriter;
+      } else {
+        ++state_;
+      }
+      q->erase(w);
+      --queued_;
+      w->slot.resolve(detail::WaitSlot::kGranted);
+      if (state_ == kWriter) {
+        return;
+      }
+    }
+  }
+
+  const std::chrono::nanoseconds aging_step_;
+  std::mutex mutex_;
+  int state_ = 0; // kWriter, or the number of readers holding the lock.
+  int queued_ = 0;
+  Queue queues_[kClasses];
+};
+
+} // namespace rwlock
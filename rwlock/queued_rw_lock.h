@@ -0,0 +1,205 @@
+#pragma once
+
+#include "rwlock/wait_strategy.h"
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+
+namespace rwlock {
+
+// User-space port of the Linux kernel's queued read-write lock (qrwlock). A
+// single 32-bit word holds the reader count and the writer state; an
+// uncontended lock or unlock is one atomic operation on it. Contended
+// lockers line up, in arrival order, on an MCS queue lock where each spins
+// on a flag in its own stack node, so only the queue head polls the lock
+// word and the line it lives on stops bouncing between cores.
+//
+// Fair: readers and writers are served in queue order, except that readers
+// arriving while other readers hold the lock (and no writer is queued
+// ahead) join them directly. Nothing ever sleeps in the kernel; waiting is
+// Wait::pause() in a loop, a pause hint with the default SpinWait. Meant for
+// pinned threads and critical sections of nanoseconds. Does not detect a
+// thread re-locking a lock it already holds.
+//
+// Lock word layout, as in the kernel:
+//   bits 9-31  number of readers holding or attempting the lock
+//   bit 8      a writer is waiting at the head of the queue
+//   bits 0-7   0xff if a writer holds the lock
+template <class Wait = SpinWait> class BasicQueuedRWLock {
+public:
+  BasicQueuedRWLock() = default;
+
+  // Acquire write lock (exclusive). Blocking (spinning).
+  int lock() {
+    std::uint32_t cnts = 0;
+    if (cnts_.compare_exchange_strong(cnts, kWriterLocked,
+                                      std::memory_order_acquire,
+                                      std::memory_order_relaxed)) {
+      return 0;
+    }
+    lock_slow();
+    return 0;
+  }
+
+  // Acquire write lock (exclusive). Non-blocking.
+  // If rc == EBUSY, lock is held for reading or writing.
+  int try_lock() {
+    std::uint32_t cnts = cnts_.load(std::memory_order_relaxed);
+    if (cnts == 0 && cnts_.compare_exchange_strong(cnts, kWriterLocked,
+                                                   std::memory_order_acquire,
+                                                   std::memory_order_relaxed)) {
+      return 0;
+    }
+    return EBUSY;
+  }
+
+  // Acquire read lock (shared). Blocking (spinning).
+  int lock_shared() {
+    const std::uint32_t cnts =
+        cnts_.fetch_add(kReaderBias, std::memory_order_acquire);
+    if ((cnts & kWriterMask) == 0) {
+      return 0;
+    }
+    lock_shared_slow();
+    return 0;
+  }
+
+  // Acquire read lock (shared). Non-blocking.
+  // If rc == EBUSY, a writer holds or is waiting for the lock.
+  int try_lock_shared() {
+    if ((cnts_.load(std::memory_order_relaxed) & kWriterMask) == 0) {
+      const std::uint32_t cnts =
+          cnts_.fetch_add(kReaderBias, std::memory_order_acquire);
+      if ((cnts & kWriterMask) == 0) {
+        return 0;
+      }
+      cnts_.fetch_sub(kReaderBias, std::memory_order_relaxed);
+    }
+    return EBUSY;
+  }
+
+  // Unlock from either a read or a write lock. Returns false if the lock was
+  // not held.
+  bool unlock() {
+    if ((cnts_.load(std::memory_order_relaxed) & kWriterLocked) ==
+        kWriterLocked) {
+      // Only the writer byte changes; readers waiting in the slow path keep
+      // their counts.
+      cnts_.fetch_sub(kWriterLocked, std::memory_order_release);
+      return true;
+    }
+    return unlock_shared();
+  }
+
+  // Unlock a read lock. Returns false if no read lock was held.
+  bool unlock_shared() {
+    std::uint32_t cnts = cnts_.load(std::memory_order_relaxed);
+    do {
+      if ((cnts >> kReaderShift) == 0) {
+        return false;
+      }
+    } while (!cnts_.compare_exchange_weak(cnts, cnts - kReaderBias,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed));
+    return true;
+  }
+
+  // Disallow move.
+  BasicQueuedRWLock(BasicQueuedRWLock &&other) = delete;
+  BasicQueuedRWLock &operator=(BasicQueuedRWLock &&other) = delete;
+
+  // Disallow copy.
+  BasicQueuedRWLock(const BasicQueuedRWLock &) = delete;
+  BasicQueuedRWLock &operator=(const BasicQueuedRWLock &) = delete;
+
+private:
+  static constexpr std::uint32_t kWriterLocked = 0xff;
+  static constexpr std::uint32_t kWriterWaiting = 0x100;
+  static constexpr std::uint32_t kWriterMask = kWriterLocked | kWriterWaiting;
+  static constexpr int kReaderShift = 9;
+  static constexpr std::uint32_t kReaderBias = 1u << kReaderShift;
+
+  // MCS queue node, on the waiting thread's stack.
+  struct Node {
+    std::atomic<Node *> next{nullptr};
+    std::atomic<bool> ready{false};
+  };
+
+  // Joins the queue and spins on our own node until we are at its head.
+  void queue_lock(Node &node) {
+    Node *prev = tail_.exchange(&node, std::memory_order_acq_rel);
+    if (prev == nullptr) {
+      return;
+    }
+    prev->next.store(&node, std::memory_order_release);
+    Wait wait;
+    while (!node.ready.load(std::memory_order_acquire)) {
+      wait.pause();
+    }
+  }
+
+  // Hands the head of the queue to our successor, if any.
+  void queue_unlock(Node &node) {
+    Node *next = node.next.load(std::memory_order_acquire);
+    if (next == nullptr) {
+      Node *expected = &node;
+      if (tail_.compare_exchange_strong(expected, nullptr,
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed)) {
+        return;
+      }
+      // A successor is linking itself in.
+      Wait wait;
+      while ((next = node.next.load(std::memory_order_acquire)) == nullptr) {
+        wait.pause();
+      }
+    }
+    next->ready.store(true, std::memory_order_release);
+  }
+
+  void lock_shared_slow() {
+    // Give back our count and wait our turn in the queue.
+    cnts_.fetch_sub(kReaderBias, std::memory_order_relaxed);
+    Node node;
+    queue_lock(node);
+    // At the head: a waiting writer ahead of us has got the lock by now, so
+    // count ourselves in and wait for it to leave.
+    cnts_.fetch_add(kReaderBias, std::memory_order_relaxed);
+    Wait wait;
+    while ((cnts_.load(std::memory_order_acquire) & kWriterLocked) != 0) {
+      wait.pause();
+    }
+    // Let the next in line in; if it is a reader it joins us.
+    queue_unlock(node);
+  }
+
+  void lock_slow() {
+    Node node;
+    queue_lock(node);
+    std::uint32_t cnts = 0;
+    if (!cnts_.compare_exchange_strong(cnts, kWriterLocked,
+                                       std::memory_order_acquire,
+                                       std::memory_order_relaxed)) {
+      // Stop new readers on the fast path, then wait for those inside.
+      cnts_.fetch_or(kWriterWaiting, std::memory_order_relaxed);
+      Wait wait;
+      for (;;) {
+        cnts = kWriterWaiting;
+        if (cnts_.compare_exchange_weak(cnts, kWriterLocked,
+                                        std::memory_order_acquire,
+                                        std::memory_order_relaxed)) {
+          break;
+        }
+        wait.pause();
+      }
+    }
+    queue_unlock(node);
+  }
+
+  std::atomic<std::uint32_t> cnts_{0};
+  std::atomic<Node *> tail_{nullptr};
+};
+
+using QueuedRWLock = BasicQueuedRWLock<>;
+
+} // namespace rwlock
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include <sched.h>
+
+#if defined(__x86_64__) && defined(__GLIBC__) && __has_include(<sys/rseq.h>)
+#include <sys/rseq.h>
+#endif
+
+#if defined(__x86_64__) && defined(RSEQ_SIG)
+#define RWLOCK_HAVE_RSEQ 1
+#else
+#define RWLOCK_HAVE_RSEQ 0
+#endif
+
+namespace rwlock {
+namespace detail {
+
+#if RWLOCK_HAVE_RSEQ
+
+// This thread's rseq area, registered by glibc (2.35+).
+inline struct rseq *rseq_area() {
+  return reinterpret_cast<struct rseq *>(
+      static_cast<char *>(__builtin_thread_pointer()) + __rseq_offset);
+}
+
+// True if this thread has a registered rseq area. glibc registers every
+// thread unless rseq is unsupported or disabled with the
+// glibc.pthread.rseq=0 tunable.
+inline bool rseq_available() {
+  return __rseq_size != 0 &&
+         static_cast<std::int32_t>(rseq_area()->cpu_id) >= 0;
+}
+
+// Adds delta to the counter of the CPU this thread runs on, at
+// base + cpu * stride, inside an rseq critical section: a plain add with no
+// lock prefix, restarted by the kernel if the thread is preempted, migrated
+// or signalled before it completes. The add is the committing instruction.
+// Returns false, without adding, if the CPU number is cpus or more.
+inline bool rseq_percpu_add(std::int64_t *base, std::size_t stride,
+                            std::size_t cpus, std::int64_t delta) {
+  struct rseq *rs = rseq_area();
+  int added;
+  __asm__ __volatile__(
+      ".pushsection __rseq_cs, \"aw\"\n\t"
+      ".balign 32\n\t"
+      "3:\n\t"
+      ".long 0x0, 0x0\n\t"
+      ".quad 1f, (2f - 1f), 4f\n\t"
+      ".popsection\n\t"
+      ".pushsection __rseq_cs_ptr_array, \"aw\"\n\t"
+      ".quad 3b\n\t"
+      ".popsection\n\t"
+      "6:\n\t"
+      "leaq 3b(%%rip), %%rax\n\t"
+      "movq %%rax, %[rseq_cs]\n\t"
+      "xorl %[added], %[added]\n\t"
+      "1:\n\t"
+      "movl %[cpu_id], %%eax\n\t"
+      // CPUs the counters were not sized for leave through the end of the
+      // section without touching memory.
+      "cmpq %[cpus], %%rax\n\t"
+      "jae 2f\n\t"
+      "movl $1, %[added]\n\t"
+      "imulq %[stride], %%rax\n\t"
+      "addq %[delta], (%[base], %%rax, 1)\n\t"
+      "2:\n\t"
+      // Abort handler, preceded by the signature the kernel checks.
+      ".pushsection __rseq_failure, \"ax\"\n\t"
+      ".byte 0x0f, 0xb9, 0x3d\n\t"
+      ".long %c[sig]\n\t"
+      "4:\n\t"
+      "jmp 6b\n\t"
+      ".popsection\n\t"
+      : [rseq_cs] "=m"(rs->rseq_cs), [added] "=&r"(added)
+      : [cpu_id] "m"(rs->cpu_id), [stride] "r"(stride), [cpus] "r"(cpus),
+        [delta] "r"(delta), [base] "r"(base), [sig] "i"(RSEQ_SIG)
+      : "rax", "cc", "memory");
+  return added != 0;
+}
+
+#else
+
+inline bool rseq_available() { return false; }
+
+inline bool rseq_percpu_add(std::int64_t *, std::size_t, std::size_t,
+                            std::int64_t) {
+  return false;
+}
+
+#endif
+
+// Adds delta to this CPU's counter at base + cpu * stride, using rseq where
+// available and an atomic add on the current CPU's counter otherwise. There
+// are cpus counters; a CPU numbered past them (e.g. one hotplugged after they
+// were sized) takes the atomic add on counter cpu % cpus. Counters must be
+// std::atomic<std::int64_t>. On the rseq path the add is ordered after this
+// thread's earlier accesses by x86's store ordering; nothing orders it before
+// later loads (see membarrier.h for that).
+inline void percpu_add(std::atomic<std::int64_t> *base, std::size_t stride,
+                       std::size_t cpus, std::int64_t delta) {
+  if (rseq_available() &&
+      rseq_percpu_add(reinterpret_cast<std::int64_t *>(base), stride, cpus,
+                      delta)) {
+    return;
+  }
+  const int cpu = sched_getcpu();
+  const std::size_t i = cpu < 0 ? 0 : static_cast<std::size_t>(cpu) % cpus;
+  reinterpret_cast<std::atomic<std::int64_t> *>(
+      reinterpret_cast<char *>(base) + i * stride)
+      ->fetch_add(delta, std::memory_order_seq_cst);
+}
+
+} // namespace detail
+} // namespace rwlock
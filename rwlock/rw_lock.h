@@ -68,6 +68,10 @@ public:
     return true;
   }
 
+  // Unlock a read lock. pthread tracks the mode itself, so this is unlock();
+  // it exists so that every engine offers the same interface to the guards.
+  bool unlock_shared() { return unlock(); }
+
   // Returns underlying pthread read-write lock.
   pthread_rwlock_t native_handle() { return rwlock_; }
 
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "rwlock/rw_lock.h"
+#include "rwlock/shared_lock.h"
+#include "rwlock/sharding.h"
+#include "rwlock/unique_lock.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace rwlock {
+
+// Fixed-capacity cache with approximate LRU eviction, sharded by key hash.
+// Each shard is guarded by its own RWLock. A hit only takes the shard's lock
+// shared: recency is recorded by setting the entry's CLOCK bit with a relaxed
+// store instead of moving the entry in a list. Misses that insert take the
+// lock exclusive and, when the shard is full, sweep the CLOCK hand to evict
+// the first entry not referenced since the hand last passed it.
+template <class K, class V, class Hash = std::hash<K>,
+          class KeyEqual = std::equal_to<K>>
+class ShardedLRUCache {
+public:
+  // capacity is the total number of entries, spread evenly over shard_count
+  // shards (rounded up to a power of two).
+  explicit ShardedLRUCache(std::size_t capacity, std::size_t shard_count = 16)
+      : shard_bits_(detail::shard_bits(shard_count)),
+        shards_(new Shard[std::size_t(1) << shard_bits_]) {
+    const std::size_t per_shard = std::max<std::size_t>(
+        1, (capacity + this->shard_count() - 1) / this->shard_count());
+    for (std::size_t i = 0; i < this->shard_count(); ++i) {
+      shards_[i].init(per_shard);
+    }
+  }
+
+  // Returns a copy of the value cached for key, if any, and marks it as
+  // recently used. Takes the shard's lock shared.
+  std::optional<V> find(const K &key) const {
+    const Shard &shard = shard_for(key);
+    SharedLock guard(shard.lock);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+      return std::nullopt;
+    }
+    shard.touch(it->second);
+    return shard.entries[it->second]->second;
+  }
+
+  // Caches key -> value, overwriting any existing value and evicting an entry
+  // if the shard is full. Returns true if key was not cached before. Takes the
+  // shard's lock exclusive.
+  bool insert_or_assign(const K &key, V value) {
+    Shard &shard = shard_for(key);
+    UniqueLock guard(shard.lock);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+      shard.entries[it->second]->second = std::move(value);
+      shard.touch(it->second);
+      return false;
+    }
+    const std::size_t slot = shard.free_slot();
+    shard.entries[slot].emplace(key, std::move(value));
+    shard.index.emplace(key, slot);
+    return true;
+  }
+
+  // Drops key from the cache. Returns true if it was cached. Takes the shard's
+  // lock exclusive.
+  bool erase(const K &key) {
+    Shard &shard = shard_for(key);
+    UniqueLock guard(shard.lock);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+      return false;
+    }
+    shard.entries[it->second].reset();
+    shard.free.push_back(it->second);
+    shard.index.erase(it);
+    return true;
+  }
+
+  // Number of cached entries. Only a snapshot under concurrent updates.
+  std::size_t size() const {
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < shard_count(); ++i) {
+      SharedLock guard(shards_[i].lock);
+      total += shards_[i].index.size();
+    }
+    return total;
+  }
+
+  // Total number of entries the cache can hold.
+  std::size_t capacity() const {
+    return shards_[0].entries.size() * shard_count();
+  }
+
+  std::size_t shard_count() const { return std::size_t(1) << shard_bits_; }
+
+  // Disallow move.
+  ShardedLRUCache(ShardedLRUCache &&other) = delete;
+  ShardedLRUCache &operator=(ShardedLRUCache &&other) = delete;
+
+  // Disallow copy.
+  ShardedLRUCache(const ShardedLRUCache &) = delete;
+  ShardedLRUCache &operator=(const ShardedLRUCache &) = delete;
+
+private:
+  struct alignas(64) Shard {
+    mutable RWLock lock;
+    std::unordered_map<K, std::size_t, Hash, KeyEqual> index;
+    std::vector<std::optional<std::pair<K, V>>> entries;
+    // CLOCK bits, one per entry. Set by readers under the shared lock.
+    std::unique_ptr<std::atomic<bool>[]> referenced;
+    // Slots never used or freed by erase.
+    std::vector<std::size_t> free;
+    std::size_t hand = 0;
+
+    void init(std::size_t capacity) {
+      entries.resize(capacity);
+      referenced.reset(new std::atomic<bool>[capacity]);
+      free.reserve(capacity);
+      for (std::size_t i = capacity; i > 0; --i) {
+        referenced[i - 1].store(false, std::memory_order_relaxed);
+        free.push_back(i - 1);
+      }
+    }
+
+    // Marks slot as recently used. Skips the store if the bit is already set
+    // so that hot entries do not keep dirtying the cache line.
+    void touch(std::size_t slot) const {
+      if (!referenced[slot].load(std::memory_order_relaxed)) {
+        referenced[slot].store(true, std::memory_order_relaxed);
+      }
+    }
+
+    // Returns an unused slot, evicting with the CLOCK hand if there is none.
+    std::size_t free_slot() {
+      if (!free.empty()) {
+        std::size_t slot = free.back();
+        free.pop_back();
+        referenced[slot].store(false, std::memory_order_relaxed);
+        return slot;
+      }
+      while (referenced[hand].exchange(false, std::memory_order_relaxed)) {
+        hand = (hand + 1) % entries.size();
+      }
+      const std::size_t victim = hand;
+      hand = (hand + 1) % entries.size();
+      index.erase(entries[victim]->first);
+      entries[victim].reset();
+      return victim;
+    }
+  };
+
+  Shard &shard_for(const K &key) const {
+    return shards_[detail::shard_index(detail::mix_hash(hasher_(key)),
+                                       shard_bits_)];
+  }
+
+  const unsigned shard_bits_;
+  std::unique_ptr<Shard[]> shards_;
+  Hash hasher_;
+};
+
+} // namespace rwlock
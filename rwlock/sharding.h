@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace rwlock {
+namespace detail {
+
+// Shard selection shared by the hash-sharded containers (ConcurrentHashMap,
+// ShardedLRUCache).
+
+// Number of bits that index count shards, rounded up to a power of two.
+inline unsigned shard_bits(std::size_t count) {
+  unsigned bits = 0;
+  while ((std::size_t(1) << bits) < count) {
+    ++bits;
+  }
+  return bits;
+}
+
+// Spreads std::hash output, which is the identity for integers, over all 64
+// bits (Fibonacci hashing), so that the top bits can pick the shard.
+inline std::uint64_t mix_hash(std::size_t hash) {
+  return static_cast<std::uint64_t>(hash) * 0x9E3779B97F4A7C15ull;
+}
+
+// The shard, out of 1 << bits, that a mix_hash() value belongs to.
+inline std::size_t shard_index(std::uint64_t hash, unsigned bits) {
+  return bits == 0 ? 0 : static_cast<std::size_t>(hash >> (64 - bits));
+}
+
+} // namespace detail
+} // namespace rwlock
@@ -1,22 +1,51 @@
 #pragma once
 
+#include "rwlock/qos_class.h"
 #include "rwlock/rw_lock.h"
+#include "rwlock/wait_strategy.h"
 #include <mutex>
+#include <stop_token>
 #include <thread>
 
 namespace rwlock {
 
 // Move‐only read‐lock guard (like std::shared_lock). Takes shared ownership of
-// RWLock, if possible.
-class SharedLock {
+// a read-write lock engine, if possible. Lock is RWLock or any engine with the
+// same interface (lock_shared, try_lock_shared, unlock_shared returning the
+// same error codes). Every engine in this package has that interface, and so
+// works with this guard and BasicUniqueLock; an engine's own comment only
+// notes where it departs from RWLock. The guard also uses an engine's
+// std::stop_token, deadline and QosClass overloads when it has them.
+template <class Lock> class BasicSharedLock {
 public:
-  explicit SharedLock(RWLock &rwlock) : lock_(&rwlock), owns_lock_(false) {
+  explicit BasicSharedLock(Lock &rwlock) : lock_(&rwlock), owns_lock_(false) {
     lock();
   }
 
+  // Blocks until the rwlock is acquired, as a request of class qos. Only for
+  // engines that serve waiters by class (QosRWLock). Later lock() calls on
+  // this guard use the same class.
+  BasicSharedLock(Lock &rwlock, QosClass qos)
+    requires QosLock<Lock>
+      : lock_(&rwlock), owns_lock_(false), qos_(qos) {
+    lock();
+  }
+
+  // Blocks until the rwlock is acquired or stop is requested. Check
+  // owns_lock() to tell which.
+  BasicSharedLock(Lock &rwlock, std::stop_token stop)
+      : lock_(&rwlock), owns_lock_(false) {
+    lock(std::move(stop));
+  }
+
   // Take shared ownership of the rwlock (blocking).
   void lock() {
-    int rc = lock_->lock_shared(); // blocking read lock
+    int rc; // blocking read lock
+    if constexpr (QosLock<Lock>) {
+      rc = lock_->lock_shared(qos_);
+    } else {
+      rc = lock_->lock_shared();
+    }
     if (rc == EINVAL || rc == EDEADLK || rc == EAGAIN) {
       lock_ = nullptr;
       throw std::system_error(rc, std::generic_category(),
@@ -25,9 +54,43 @@ public:
     owns_lock_ = true;
   }
 
+  // Take shared ownership of the rwlock (blocking), unless stop is requested
+  // first. Returns false, without the lock, if it was. Engines with their own
+  // stop_token overload are woken as soon as stop is requested; others are
+  // polled.
+  bool lock(std::stop_token stop) {
+    int rc;
+    if constexpr (requires(Lock &l) { l.lock_shared(stop); }) {
+      rc = lock_->lock_shared(stop);
+    } else {
+      SleepWait<> wait;
+      for (;;) {
+        if (stop.stop_requested()) {
+          rc = ECANCELED;
+          break;
+        }
+        rc = lock_->try_lock_shared();
+        if (rc != EBUSY && rc != EAGAIN) {
+          break;
+        }
+        wait.pause();
+      }
+    }
+    if (rc == ECANCELED) {
+      return false;
+    }
+    if (rc != 0) {
+      lock_ = nullptr;
+      throw std::system_error(rc, std::generic_category(),
+                              "Failed to lock() SharedLock.");
+    }
+    owns_lock_ = true;
+    return true;
+  }
+
   // Tries to take shared ownership of the rwlock (non-blocking).
   bool try_lock() {
-    int rc = lock_->try_lock();
+    int rc = lock_->try_lock_shared();
     if (rc == 0) {
       owns_lock_ = true;
     } else if (rc == EINVAL) {
@@ -40,63 +103,89 @@ public:
   }
 
   // Tries to take shared ownership of the rwlock, returns if lock has been
-  // unavailable for the specified time duration.
-  template <class Rep, class Period>
-  bool
-  try_lock_for(const std::chrono::duration<Rep, Period> &timeout_duration) {
-    return try_lock_until(std::chrono::steady_clock::now() + timeout_duration);
+  // unavailable for the specified time duration. wait decides how to back off
+  // between attempts (see wait_strategy.h).
+  template <class Rep, class Period, class Wait = SleepWait<>>
+  bool try_lock_for(const std::chrono::duration<Rep, Period> &timeout_duration,
+                    Wait wait = Wait()) {
+    return try_lock_until(std::chrono::steady_clock::now() + timeout_duration,
+                          wait);
   }
 
   // Tries to take shared ownership of the rwlock, returns if the mutex has been
-  // unavailable until specified time point has been reached.
-  template <class Clock, class Duration>
+  // unavailable until specified time point has been reached. Engines with
+  // their own timed acquisition (AbortableQueueRWLock) wait in their queue
+  // instead of polling.
+  template <class Clock, class Duration, class Wait = SleepWait<>>
   bool
-  try_lock_until(const std::chrono::time_point<Clock, Duration> &timeout_time) {
-    using namespace std::chrono;
+  try_lock_until(const std::chrono::time_point<Clock, Duration> &timeout_time,
+                 Wait wait = Wait()) {
+    if constexpr (requires(Lock &l) {
+                    l.try_lock_shared_until(timeout_time);
+                  }) {
+      // The engine can wait in its queue and leave it at the deadline.
+      int rc = lock_->try_lock_shared_until(timeout_time);
+      if (rc == 0) {
+        owns_lock_ = true;
+      } else if (rc != ETIMEDOUT && rc != EBUSY && rc != EAGAIN) {
+        lock_ = nullptr;
+        throw std::system_error(rc, std::generic_category(),
+                                "Failed to try_lock_until() SharedLock.");
+      }
+      return owns_lock_;
+    }
     while (Clock::now() < timeout_time) {
       if (try_lock()) {
         return true;
       }
-      std::this_thread::sleep_for(0.01ms);
+      wait.pause();
     }
     return false; // Timed out
   }
 
   // Releases ownership of the rwlock.
   void unlock() {
-    if (owns_lock_ && lock_->unlock()) {
+    if (owns_lock_ && lock_->unlock_shared()) {
       owns_lock_ = false;
     }
   }
 
   // Swaps state with another shared lock.
-  void swap(SharedLock &other) {
+  void swap(BasicSharedLock &other) {
     std::swap(lock_, other.lock_);
     std::swap(owns_lock_, other.owns_lock_);
+    std::swap(qos_, other.qos_);
   }
 
   // Disassociates the rwlock without unlocking (i.e., releasing
   // ownership of) it.
-  RWLock *release() {
-    RWLock *temp = lock_;
+  Lock *release() {
+    Lock *temp = lock_;
     lock_ = nullptr;
     owns_lock_ = false;
     return temp;
   }
 
   // Returns a pointer to the associated mutex
-  RWLock *rwlock() { return lock_; }
+  Lock *rwlock() { return lock_; }
 
   // Returns true if we currently own the shared lock
   bool owns_lock() const noexcept { return owns_lock_; }
 
-  ~SharedLock() {
+  // Returns the QoS class this guard requests the lock with
+  QosClass qos() const noexcept
+    requires QosLock<Lock>
+  {
+    return qos_;
+  }
+
+  ~BasicSharedLock() {
     if (owns_lock_) {
-      lock_->unlock();
+      lock_->unlock_shared();
     }
   }
 
-  SharedLock(RWLock &rwlock, std::try_to_lock_t)
+  BasicSharedLock(Lock &rwlock, std::try_to_lock_t)
       : lock_(&rwlock), owns_lock_(false) {
     int rc = lock_->try_lock_shared();
     if (rc == 0) {
@@ -112,19 +201,25 @@ public:
     }
   }
 
-  SharedLock(SharedLock &&other) noexcept
-      : lock_(other.lock_), owns_lock_(other.owns_lock_) {
+  // Takes ownership of a lock the caller already holds in shared mode, e.g.
+  // after lock_shared_when().
+  BasicSharedLock(Lock &rwlock, std::adopt_lock_t) noexcept
+      : lock_(&rwlock), owns_lock_(true) {}
+
+  BasicSharedLock(BasicSharedLock &&other) noexcept
+      : lock_(other.lock_), owns_lock_(other.owns_lock_), qos_(other.qos_) {
     other.lock_ = nullptr;
     other.owns_lock_ = false;
   }
 
-  SharedLock &operator=(SharedLock &&other) noexcept {
+  BasicSharedLock &operator=(BasicSharedLock &&other) noexcept {
     if (this != &other) {
       if (owns_lock_) {
-        lock_->unlock();
+        lock_->unlock_shared();
       }
       lock_ = other.lock_;
       owns_lock_ = other.owns_lock_;
+      qos_ = other.qos_;
 
       other.lock_ = nullptr;
       other.owns_lock_ = false;
@@ -132,12 +227,15 @@ public:
     return *this;
   }
 
-  SharedLock(const SharedLock &) = delete;
-  SharedLock &operator=(const SharedLock &) = delete;
+  BasicSharedLock(const BasicSharedLock &) = delete;
+  BasicSharedLock &operator=(const BasicSharedLock &) = delete;
 
 private:
-  RWLock *lock_;
+  Lock *lock_;
   bool owns_lock_;
+  QosClass qos_ = QosClass::kNormal;
 };
 
-} // namespace rwlock
\ No newline at end of file
+using SharedLock = BasicSharedLock<RWLock>;
+
+} // namespace rwlock
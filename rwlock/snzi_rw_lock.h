@@ -0,0 +1,234 @@
+#pragma once
+
+#include "rwlock/futex.h"
+#include "rwlock/wait_strategy.h"
+#include "rwlock/writer_gate.h"
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+namespace rwlock {
+
+// Read-write lock for very many reader threads. Readers register in a
+// scalable non-zero indicator (SNZI, Ellen et al., PODC 2007): a binary tree
+// of counters where a reader arrives at and departs from a leaf, and a node
+// only tells its parent when it turns non-zero or back to zero. The writer
+// just checks the root, so its cost does not grow with the number of
+// leaves, and readers mostly touch their own leaf's cache line.
+//
+// A read lock must be released by the thread that took it (it departs from
+// that thread's leaf). The reader count has no limit, so EAGAIN is never
+// returned.
+// Writer preferring: readers back off while a writer holds or waits for the
+// lock. A writer waits for the readers inside to leave with Wait.
+template <class Wait = DefaultWait> class BasicSnziRWLock {
+public:
+  // leaves is the number of tree leaves readers are spread over, by thread;
+  // 0 means one per hardware thread.
+  explicit BasicSnziRWLock(std::size_t leaves = 0)
+      : leaves_(leaves != 0 ? leaves : default_leaves()),
+        nodes_(std::make_unique<Node[]>(2 * leaves_ - 1)) {}
+
+  // Acquire write lock (exclusive). Blocking.
+  // If rc == EDEADLK, the calling thread already holds the write lock.
+  int lock() {
+    const int rc = gate_.lock();
+    if (rc != 0) {
+      return rc;
+    }
+    // New readers now back off; wait for those inside to leave.
+    Wait wait;
+    std::uint32_t r;
+    while ((r = root_.load(std::memory_order_seq_cst)) != 0) {
+      wait.wait(root_, r);
+    }
+    return 0;
+  }
+
+  // Acquire write lock (exclusive). Non-blocking.
+  // If rc == EBUSY, lock is held for reading or writing.
+  int try_lock() {
+    const int rc = gate_.try_lock();
+    if (rc != 0) {
+      return rc;
+    }
+    if (root_.load(std::memory_order_seq_cst) != 0) {
+      gate_.unlock();
+      return EBUSY;
+    }
+    return 0;
+  }
+
+  // Acquire read lock (shared). Blocking.
+  int lock_shared() {
+    const std::size_t leaf = this_thread_leaf();
+    for (;;) {
+      arrive(leaf);
+      std::uint32_t w = gate_.state(std::memory_order_seq_cst);
+      if (w == kFree) {
+        return 0;
+      }
+      depart(leaf);
+      gate_.park(w);
+    }
+  }
+
+  // Acquire read lock (shared). Non-blocking.
+  // If rc == EBUSY, a writer holds or is waiting for the lock.
+  int try_lock_shared() {
+    if (gate_.state(std::memory_order_relaxed) != kFree) {
+      return EBUSY;
+    }
+    const std::size_t leaf = this_thread_leaf();
+    arrive(leaf);
+    if (gate_.state(std::memory_order_seq_cst) != kFree) {
+      depart(leaf);
+      return EBUSY;
+    }
+    return 0;
+  }
+
+  // Unlock from either a read or a write lock. Returns false if the lock was
+  // not held.
+  bool unlock() {
+    if (gate_.unlock()) {
+      return true;
+    }
+    return unlock_shared();
+  }
+
+  // Unlock a read lock held by this thread. Returns false if this thread's
+  // leaf has no readers.
+  bool unlock_shared() {
+    const std::size_t leaf = this_thread_leaf();
+    if (count(nodes_[leaf].word.load(std::memory_order_relaxed)) < kOne) {
+      return false;
+    }
+    depart(leaf);
+    return true;
+  }
+
+  // Disallow move.
+  BasicSnziRWLock(BasicSnziRWLock &&other) = delete;
+  BasicSnziRWLock &operator=(BasicSnziRWLock &&other) = delete;
+
+  // Disallow copy.
+  BasicSnziRWLock(const BasicSnziRWLock &) = delete;
+  BasicSnziRWLock &operator=(const BasicSnziRWLock &) = delete;
+
+private:
+  static constexpr std::uint32_t kFree = detail::WriterGate::kFree;
+
+  // Tree node counts are kept doubled so the algorithm's intermediate 1/2
+  // state is representable: kHalf means "arriving at the parent".
+  static constexpr std::uint32_t kHalf = 1;
+  static constexpr std::uint32_t kOne = 2;
+
+  // Parent of the top tree node: the root counter root_.
+  static constexpr std::size_t kRoot = static_cast<std::size_t>(-1);
+
+  // Non-root tree node: doubled count in the low half, version in the high
+  // half. The version stops a stale 0 -> 1/2 transition from being confused
+  // with a later one.
+  struct alignas(64) Node {
+    std::atomic<std::uint64_t> word{0};
+  };
+
+  static std::uint32_t count(std::uint64_t word) {
+    return static_cast<std::uint32_t>(word);
+  }
+  static std::uint64_t make(std::uint32_t c, std::uint64_t word) {
+    return (word & ~std::uint64_t{0xffffffff}) | c;
+  }
+  static std::uint64_t next_version(std::uint64_t word) {
+    return (word & ~std::uint64_t{0xffffffff}) + (std::uint64_t{1} << 32);
+  }
+
+  static std::size_t default_leaves() {
+    const unsigned n = std::thread::hardware_concurrency();
+    return n != 0 ? n : 1;
+  }
+
+  // This thread's leaf. Nodes form a binary heap; leaves are the last
+  // leaves_ of its 2 * leaves_ - 1 nodes.
+  std::size_t this_thread_leaf() const {
+    static std::atomic<std::size_t> next{0};
+    thread_local std::size_t index =
+        next.fetch_add(1, std::memory_order_relaxed);
+    return leaves_ - 1 + index % leaves_;
+  }
+
+  // Arrives at node i, and at its parent if i turns non-zero.
+  void arrive(std::size_t i) {
+    if (i == kRoot) {
+      root_.fetch_add(1, std::memory_order_seq_cst);
+      return;
+    }
+    std::atomic<std::uint64_t> &word = nodes_[i].word;
+    const std::size_t parent = parent_of(i);
+    bool arrived = false;
+    int undo = 0;
+    while (!arrived) {
+      std::uint64_t x = word.load(std::memory_order_seq_cst);
+      if (count(x) >= kOne) {
+        arrived = word.compare_exchange_strong(x, x + kOne,
+                                               std::memory_order_seq_cst);
+        continue;
+      }
+      if (count(x) == 0) {
+        const std::uint64_t half = next_version(x) | kHalf;
+        if (!word.compare_exchange_strong(x, half,
+                                          std::memory_order_seq_cst)) {
+          continue;
+        }
+        arrived = true;
+        x = half;
+      }
+      // x is 1/2: help finish the arrival at the parent.
+      arrive(parent);
+      std::uint64_t expected = x;
+      if (!word.compare_exchange_strong(expected, make(kOne, x),
+                                        std::memory_order_seq_cst)) {
+        ++undo; // Someone else completed it; our parent arrival is extra.
+      }
+    }
+    for (; undo > 0; --undo) {
+      depart(parent);
+    }
+  }
+
+  // Departs from node i, and from its parent if i turns zero.
+  void depart(std::size_t i) {
+    if (i == kRoot) {
+      if (root_.fetch_sub(1, std::memory_order_seq_cst) == 1 &&
+          gate_.state(std::memory_order_seq_cst) != kFree) {
+        detail::futex_wake(root_); // Last reader out lets the writer in.
+      }
+      return;
+    }
+    std::atomic<std::uint64_t> &word = nodes_[i].word;
+    std::uint64_t x = word.load(std::memory_order_seq_cst);
+    while (!word.compare_exchange_weak(x, x - kOne,
+                                       std::memory_order_seq_cst)) {
+    }
+    if (count(x) == kOne) {
+      depart(parent_of(i));
+    }
+  }
+
+  static std::size_t parent_of(std::size_t i) {
+    return i == 0 ? kRoot : (i - 1) / 2;
+  }
+
+  const std::size_t leaves_;
+  std::unique_ptr<Node[]> nodes_;
+  alignas(64) std::atomic<std::uint32_t> root_{0}; // Readers at the root.
+  alignas(64) detail::WriterGate gate_;
+};
+
+using SnziRWLock = BasicSnziRWLock<>;
+
+} // namespace rwlock
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <gtest/gtest.h>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "rwlock/shared_lock.h"
+#include "rwlock/unique_lock.h"
+
+// Guard arguments after the lock for thread t: none.
+struct NoGuardArgs {
+  std::tuple<> operator()(int) const { return {}; }
+};
+
+// Writers exclude each other and readers under contention. kThreads threads
+// run kIters iterations each; one in kWriteEvery takes the write lock and
+// bumps counter twice, the rest take the read lock and check that it is
+// even. guard_args(t) returns the extra guard constructor arguments of
+// thread t as a tuple, e.g. its QosClass.
+template <class Lock, int kThreads, int kIters, int kWriteEvery = 4,
+          class GuardArgs = NoGuardArgs>
+void run_counter_test(Lock &lock, GuardArgs guard_args = {}) {
+  static_assert(kIters % kWriteEvery == 0);
+  long counter = 0;
+  std::atomic<bool> torn{false};
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      const auto args = std::tuple_cat(std::tie(lock), guard_args(t));
+      for (int i = 0; i < kIters; ++i) {
+        if ((i + t) % kWriteEvery != 0) {
+          auto guard =
+              std::make_from_tuple<rwlock::BasicSharedLock<Lock>>(args);
+          if (counter % 2 != 0) {
+            torn.store(true);
+          }
+        } else {
+          auto guard =
+              std::make_from_tuple<rwlock::BasicUniqueLock<Lock>>(args);
+          ++counter;
+          ++counter;
+        }
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  ASSERT_FALSE(torn.load());
+  ASSERT_EQ(counter, 2L * kThreads * (kIters / kWriteEvery));
+}
@@ -0,0 +1,183 @@
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "rwlock/abortable_queue_rw_lock.h"
+#include "rwlock/shared_lock.h"
+#include "rwlock/tests/counter_test.h"
+#include "rwlock/unique_lock.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+} // namespace
+
+// Timed calls give up with ETIMEDOUT when the lock stays busy.
+TEST(AbortableQueueRWLockTest, TestTryLock) {
+  rwlock::AbortableQueueRWLock lock;
+
+  ASSERT_EQ(lock.try_lock(), 0);
+  ASSERT_EQ(lock.try_lock(), EBUSY);
+  ASSERT_EQ(lock.try_lock_shared(), EBUSY);
+  ASSERT_EQ(lock.try_lock_for(std::chrono::milliseconds(5)), ETIMEDOUT);
+  ASSERT_EQ(lock.try_lock_shared_for(std::chrono::milliseconds(5)),
+            ETIMEDOUT);
+  ASSERT_TRUE(lock.unlock());
+  ASSERT_FALSE(lock.unlock());
+
+  ASSERT_EQ(lock.try_lock_shared(), 0);
+  ASSERT_EQ(lock.try_lock_shared_for(std::chrono::milliseconds(5)), 0);
+  ASSERT_EQ(lock.try_lock_for(std::chrono::milliseconds(5)), ETIMEDOUT);
+  ASSERT_TRUE(lock.unlock_shared());
+  ASSERT_TRUE(lock.unlock());
+  ASSERT_FALSE(lock.unlock_shared());
+  ASSERT_EQ(lock.try_lock_for(std::chrono::milliseconds(5)), 0);
+  ASSERT_TRUE(lock.unlock());
+}
+
+// The guards' timed acquisition goes through the engine's queue and gives
+// up on time.
+TEST(AbortableQueueRWLockTest, TestGuardTryLockFor) {
+  rwlock::AbortableQueueRWLock lock;
+  rwlock::BasicUniqueLock<rwlock::AbortableQueueRWLock> writer(lock);
+  writer.unlock();
+  ASSERT_EQ(lock.lock(), 0);
+  const auto start = Clock::now();
+  ASSERT_FALSE(writer.try_lock_for(std::chrono::milliseconds(20)));
+  const auto waited = Clock::now() - start;
+  ASSERT_GE(waited, std::chrono::milliseconds(20));
+  ASSERT_LT(waited, std::chrono::seconds(2));
+
+  rwlock::BasicSharedLock<rwlock::AbortableQueueRWLock> reader(
+      lock, std::try_to_lock);
+  ASSERT_FALSE(reader.try_lock_for(std::chrono::milliseconds(5)));
+
+  std::thread release([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    lock.unlock();
+  });
+  ASSERT_TRUE(reader.try_lock_for(std::chrono::seconds(10)));
+  release.join();
+  ASSERT_TRUE(reader.owns_lock());
+  reader.unlock();
+  ASSERT_TRUE(writer.try_lock_until(Clock::now() + std::chrono::seconds(1)));
+}
+
+// Queued lockers are served in arrival order; one that times out leaves the
+// queue without disturbing the others.
+TEST(AbortableQueueRWLockTest, TestFifoWithAbort) {
+  rwlock::AbortableQueueRWLock lock;
+  std::mutex m;
+  std::vector<int> order;
+  ASSERT_EQ(lock.lock(), 0);
+
+  std::vector<std::thread> threads;
+  auto queue = [&](int id, bool exclusive) {
+    threads.emplace_back([&, id, exclusive] {
+      if (exclusive) {
+        rwlock::BasicUniqueLock<rwlock::AbortableQueueRWLock> guard(lock);
+        std::lock_guard<std::mutex> g(m);
+        order.push_back(id);
+      } else {
+        rwlock::BasicSharedLock<rwlock::AbortableQueueRWLock> guard(lock);
+        std::lock_guard<std::mutex> g(m);
+        order.push_back(id);
+      }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  };
+  queue(1, /*exclusive=*/true);
+  std::thread impatient([&] {
+    ASSERT_EQ(lock.try_lock_for(std::chrono::milliseconds(30)), ETIMEDOUT);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  queue(2, /*exclusive=*/false);
+  queue(3, /*exclusive=*/true);
+  impatient.join();
+  ASSERT_TRUE(lock.unlock());
+  for (auto &t : threads) {
+    t.join();
+  }
+  ASSERT_EQ(order, (std::vector<int>{1, 2, 3}));
+}
+
+// A timed-out writer at the head lets the readers queued behind it join the
+// readers inside.
+TEST(AbortableQueueRWLockTest, TestAbortedWriterUnblocksReaders) {
+  rwlock::AbortableQueueRWLock lock;
+  ASSERT_EQ(lock.lock_shared(), 0);
+
+  std::thread writer([&] {
+    ASSERT_EQ(lock.try_lock_for(std::chrono::milliseconds(50)), ETIMEDOUT);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  std::atomic<bool> reader_in{false};
+  std::thread reader([&] {
+    rwlock::BasicSharedLock<rwlock::AbortableQueueRWLock> guard(lock);
+    reader_in.store(true);
+  });
+  writer.join();
+  reader.join();
+  ASSERT_TRUE(reader_in.load());
+  ASSERT_TRUE(lock.unlock_shared());
+}
+
+TEST(AbortableQueueRWLockTest, TestContention) {
+  rwlock::AbortableQueueRWLock lock;
+  run_counter_test<rwlock::AbortableQueueRWLock, 8, 2000>(lock);
+}
+
+// A timed reader queued between two writers unlinks itself without letting
+// anyone in. The waiters on both sides of it keep their places, and a locker
+// arriving afterwards queues behind them.
+TEST(AbortableQueueRWLockTest, TestAbortFromMiddle) {
+  rwlock::AbortableQueueRWLock lock;
+  std::mutex m;
+  std::vector<int> order;
+  ASSERT_EQ(lock.lock(), 0);
+
+  std::vector<std::thread> threads;
+  auto queue = [&](int id, bool exclusive) {
+    threads.emplace_back([&, id, exclusive] {
+      if (exclusive) {
+        rwlock::BasicUniqueLock<rwlock::AbortableQueueRWLock> guard(lock);
+        std::lock_guard<std::mutex> g(m);
+        order.push_back(id);
+      } else {
+        rwlock::BasicSharedLock<rwlock::AbortableQueueRWLock> guard(lock);
+        std::lock_guard<std::mutex> g(m);
+        order.push_back(id);
+      }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  };
+  queue(1, /*exclusive=*/true);
+  std::atomic<int> aborted{-1};
+  std::thread impatient([&] {
+    aborted.store(lock.try_lock_shared_for(std::chrono::milliseconds(60)));
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  queue(2, /*exclusive=*/true);
+  queue(3, /*exclusive=*/false);
+  impatient.join();
+  ASSERT_EQ(aborted.load(), ETIMEDOUT);
+  {
+    std::lock_guard<std::mutex> g(m);
+    ASSERT_TRUE(order.empty());
+  }
+  ASSERT_EQ(lock.try_lock_shared(), EBUSY);
+
+  queue(4, /*exclusive=*/true);
+  ASSERT_TRUE(lock.unlock());
+  for (auto &t : threads) {
+    t.join();
+  }
+  ASSERT_EQ(order, (std::vector<int>{1, 2, 3, 4}));
+  ASSERT_EQ(lock.try_lock(), 0);
+  ASSERT_TRUE(lock.unlock());
+}
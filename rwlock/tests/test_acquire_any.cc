@@ -0,0 +1,112 @@
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "rwlock/acquire_any.h"
+#include "rwlock/futex_rw_lock.h"
+#include "rwlock/multi_lock.h"
+
+// Free locks are taken without waiting.
+TEST(AcquireAnyTest, TestFreeLock) {
+  rwlock::FutexRWLock a, b, c;
+  ASSERT_EQ(a.lock(), 0);
+  ASSERT_EQ(rwlock::acquire_any({&a, &b, &c}, rwlock::LockMode::kExclusive),
+            1);
+  ASSERT_EQ(b.try_lock_shared(), EBUSY);
+  ASSERT_EQ(rwlock::try_acquire_any({&a, &b, &c}, rwlock::LockMode::kShared),
+            2);
+  ASSERT_EQ(rwlock::try_acquire_any({&a, &b}, rwlock::LockMode::kShared), -1);
+  a.unlock();
+  b.unlock();
+  c.unlock_shared();
+}
+
+// A waiter sleeps on all words and takes whichever lock is released.
+TEST(AcquireAnyTest, TestWakesOnAnyRelease) {
+  for (int released = 0; released < 3; ++released) {
+    rwlock::FutexRWLock locks[3];
+    for (auto &lock : locks) {
+      ASSERT_EQ(lock.lock(), 0);
+    }
+    std::atomic<int> got{-1};
+    std::thread waiter([&] {
+      got.store(rwlock::acquire_any({&locks[0], &locks[1], &locks[2]},
+                                    rwlock::LockMode::kShared));
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ASSERT_EQ(got.load(), -1);
+    locks[released].unlock();
+    waiter.join();
+    ASSERT_EQ(got.load(), released);
+    ASSERT_TRUE(locks[released].unlock_shared());
+    for (int i = 0; i < 3; ++i) {
+      if (i != released) {
+        locks[i].unlock();
+      }
+    }
+  }
+}
+
+// The timed variant gives up and takes nothing.
+TEST(AcquireAnyTest, TestTimeout) {
+  rwlock::FutexRWLock a, b;
+  ASSERT_EQ(a.lock_shared(), 0);
+  ASSERT_EQ(b.lock_shared(), 0);
+  const auto start = std::chrono::steady_clock::now();
+  ASSERT_EQ(rwlock::acquire_any_until({&a, &b}, rwlock::LockMode::kExclusive,
+                                      start + std::chrono::milliseconds(10)),
+            -1);
+  ASSERT_GE(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(10));
+  ASSERT_TRUE(a.unlock_shared());
+  ASSERT_TRUE(b.unlock_shared());
+  ASSERT_EQ(a.try_lock(), 0);
+  ASSERT_EQ(b.try_lock(), 0);
+  a.unlock();
+  b.unlock();
+}
+
+// Consumers spread over shards and every acquisition is exclusive.
+TEST(AcquireAnyTest, TestShardedConsumers) {
+  const int kShards = 4;
+  const int kThreads = 4;
+  const int kIters = 500;
+  std::vector<rwlock::FutexRWLock> shards(kShards);
+  std::vector<rwlock::FutexRWLock *> ptrs;
+  for (auto &shard : shards) {
+    ptrs.push_back(&shard);
+  }
+  int counts[kShards] = {};
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < kIters; ++i) {
+        const int s = rwlock::acquire_any<rwlock::FutexRWLock>(
+            ptrs, rwlock::LockMode::kExclusive);
+        ++counts[s];
+        shards[s].unlock();
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  int total = 0;
+  for (int c : counts) {
+    total += c;
+  }
+  ASSERT_EQ(total, kThreads * kIters);
+}
+
+// Empty input is rejected.
+TEST(AcquireAnyTest, TestEmpty) {
+  std::vector<rwlock::FutexRWLock *> none;
+  ASSERT_THROW(rwlock::acquire_any<rwlock::FutexRWLock>(
+                   none, rwlock::LockMode::kShared),
+               std::system_error);
+}
@@ -0,0 +1,102 @@
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+#include "rwlock/asymmetric_rw_lock.h"
+#include "rwlock/shared_lock.h"
+#include "rwlock/tests/counter_test.h"
+#include "rwlock/unique_lock.h"
+
+// Unlock calls fail once nothing is held, and the writer relocking gets
+// EDEADLK.
+TEST(AsymmetricRWLockTest, TestTryLock) {
+  rwlock::AsymmetricRWLock lock;
+
+  ASSERT_EQ(lock.try_lock(), 0);
+  ASSERT_EQ(lock.try_lock(), EDEADLK);
+  ASSERT_EQ(lock.lock(), EDEADLK);
+  ASSERT_EQ(lock.try_lock_shared(), EBUSY);
+  ASSERT_TRUE(lock.unlock());
+
+  ASSERT_EQ(lock.try_lock_shared(), 0);
+  ASSERT_EQ(lock.lock_shared(), 0);
+  ASSERT_EQ(lock.try_lock(), EBUSY);
+  ASSERT_TRUE(lock.unlock_shared());
+  ASSERT_EQ(lock.try_lock(), EBUSY);
+  ASSERT_TRUE(lock.unlock());
+  ASSERT_FALSE(lock.unlock());
+  ASSERT_FALSE(lock.unlock_shared());
+  ASSERT_EQ(lock.try_lock(), 0);
+  ASSERT_TRUE(lock.unlock());
+}
+
+// Read locks beyond a thread's slots go through the shared counter, and
+// slots are per lock.
+TEST(AsymmetricRWLockTest, TestManyReadLocks) {
+  const int kLocks = 3 * static_cast<int>(rwlock::detail::kAsymmetricSlots);
+  std::vector<rwlock::AsymmetricRWLock> locks(2);
+  for (int i = 0; i < kLocks; ++i) {
+    ASSERT_EQ(locks[i % 2].lock_shared(), 0);
+  }
+  ASSERT_EQ(locks[0].try_lock(), EBUSY);
+  ASSERT_EQ(locks[1].try_lock(), EBUSY);
+  for (int i = 0; i < kLocks; ++i) {
+    ASSERT_TRUE(locks[i % 2].unlock_shared());
+  }
+  ASSERT_FALSE(locks[0].unlock_shared());
+  ASSERT_EQ(locks[0].try_lock(), 0);
+  ASSERT_EQ(locks[1].try_lock(), 0);
+  ASSERT_TRUE(locks[0].unlock());
+  ASSERT_TRUE(locks[1].unlock());
+}
+
+// A reader thread's record is reused after it exits, with nothing held.
+TEST(AsymmetricRWLockTest, TestThreadExit) {
+  rwlock::AsymmetricRWLock lock;
+  for (int i = 0; i < 16; ++i) {
+    std::thread([&] {
+      rwlock::BasicSharedLock<rwlock::AsymmetricRWLock> guard(lock);
+    }).join();
+  }
+  ASSERT_EQ(lock.try_lock(), 0);
+  ASSERT_TRUE(lock.unlock());
+}
+
+// A writer waits for a reader inside.
+TEST(AsymmetricRWLockTest, TestWriterWaitsForReader) {
+  rwlock::AsymmetricRWLock lock;
+  std::atomic<bool> reader_in{false};
+  std::atomic<bool> release{false};
+  std::thread reader([&] {
+    rwlock::BasicSharedLock<rwlock::AsymmetricRWLock> guard(lock);
+    reader_in.store(true);
+    while (!release.load()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  });
+  while (!reader_in.load()) {
+    std::this_thread::yield();
+  }
+
+  std::atomic<bool> writer_in{false};
+  std::thread writer([&] {
+    rwlock::BasicUniqueLock<rwlock::AsymmetricRWLock> guard(lock);
+    writer_in.store(true);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ASSERT_FALSE(writer_in.load());
+  ASSERT_EQ(lock.try_lock_shared(), EBUSY);
+  release.store(true);
+  reader.join();
+  writer.join();
+  ASSERT_TRUE(writer_in.load());
+}
+
+// Every write acquisition runs a membarrier before it scans the readers.
+TEST(AsymmetricRWLockTest, TestContention) {
+  rwlock::AsymmetricRWLock lock;
+  run_counter_test<rwlock::AsymmetricRWLock, 8, 3200, 16>(lock);
+}
@@ -0,0 +1,191 @@
+#include <atomic>
+#include <coroutine>
+#include <cstdlib>
+#include <exception>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+#include "rwlock/async_rw_lock.h"
+
+namespace {
+
+// Fire-and-forget coroutine; runs eagerly until its first suspension.
+struct Task {
+  struct promise_type {
+    Task get_return_object() { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+// Suspends coroutines until open() is called.
+struct Gate {
+  struct Awaiter {
+    Gate *gate;
+    bool await_ready() { return false; }
+    void await_suspend(std::coroutine_handle<> handle) {
+      gate->waiting.push_back(handle);
+    }
+    void await_resume() {}
+  };
+
+  Awaiter wait() { return Awaiter{this}; }
+
+  void open() {
+    std::vector<std::coroutine_handle<>> waiting;
+    waiting.swap(this->waiting);
+    for (auto handle : waiting) {
+      handle.resume();
+    }
+  }
+
+  std::vector<std::coroutine_handle<>> waiting;
+};
+
+} // namespace
+
+// Readers share the lock, a writer queues behind them and later readers queue
+// behind the writer.
+TEST(AsyncRWLockTest, TestWriterQueuesBehindReaders) {
+  rwlock::AsyncRWLock lock;
+  Gate gate;
+  int active_readers = 0;
+  bool writer_ran = false;
+  bool late_reader_ran = false;
+
+  auto reader = [&]() -> Task {
+    rwlock::AsyncSharedLock guard = co_await lock.shared();
+    EXPECT_TRUE(guard.owns_lock());
+    ++active_readers;
+    co_await gate.wait();
+    --active_readers;
+  };
+  auto writer = [&]() -> Task {
+    rwlock::AsyncUniqueLock guard = co_await lock.exclusive();
+    EXPECT_EQ(active_readers, 0);
+    writer_ran = true;
+  };
+  auto late_reader = [&]() -> Task {
+    rwlock::AsyncSharedLock guard = co_await lock.shared();
+    EXPECT_TRUE(writer_ran);
+    late_reader_ran = true;
+  };
+
+  reader();
+  reader();
+  EXPECT_EQ(active_readers, 2);
+
+  writer();
+  late_reader();
+  EXPECT_FALSE(writer_ran);
+  EXPECT_FALSE(late_reader_ran);
+
+  gate.open();
+  EXPECT_TRUE(writer_ran);
+  EXPECT_TRUE(late_reader_ran);
+  EXPECT_TRUE(lock.try_lock());
+  lock.unlock();
+}
+
+// Granted coroutines are handed to the executor rather than resumed inline.
+TEST(AsyncRWLockTest, TestResumesOnExecutor) {
+  std::vector<std::coroutine_handle<>> scheduled;
+  rwlock::AsyncRWLock lock(
+      [&](std::coroutine_handle<> handle) { scheduled.push_back(handle); });
+  bool writer_ran = false;
+
+  auto writer = [&]() -> Task {
+    rwlock::AsyncUniqueLock guard = co_await lock.exclusive();
+    writer_ran = true;
+  };
+
+  ASSERT_TRUE(lock.try_lock_shared());
+  writer();
+  EXPECT_FALSE(writer_ran);
+
+  lock.unlock_shared();
+  EXPECT_FALSE(writer_ran);
+  ASSERT_EQ(scheduled.size(), 1u);
+  // The lock is already owned by the writer while it is in the executor queue.
+  EXPECT_FALSE(lock.try_lock_shared());
+
+  scheduled.front().resume();
+  EXPECT_TRUE(writer_ran);
+  EXPECT_TRUE(lock.try_lock_shared());
+  lock.unlock_shared();
+}
+
+TEST(AsyncRWLockTest, TestGuardMoveSemantics) {
+  rwlock::AsyncRWLock lock;
+  ASSERT_TRUE(lock.try_lock());
+  rwlock::AsyncUniqueLock first(lock, std::adopt_lock);
+
+  rwlock::AsyncUniqueLock second(std::move(first));
+  EXPECT_FALSE(first.owns_lock());
+  EXPECT_EQ(first.rwlock(), nullptr);
+  EXPECT_TRUE(second.owns_lock());
+  EXPECT_EQ(second.rwlock(), &lock);
+
+  second.unlock();
+  EXPECT_FALSE(second.owns_lock());
+  EXPECT_TRUE(second.try_lock());
+
+  rwlock::AsyncRWLock *released = second.release();
+  EXPECT_EQ(released, &lock);
+  EXPECT_FALSE(lock.try_lock_shared());
+  lock.unlock();
+
+  ASSERT_TRUE(lock.try_lock_shared());
+  rwlock::AsyncSharedLock reader(lock, std::adopt_lock);
+  rwlock::AsyncSharedLock other(lock, std::adopt_lock);
+  ASSERT_TRUE(lock.try_lock_shared());
+  other = std::move(reader);
+  EXPECT_FALSE(reader.owns_lock());
+  EXPECT_TRUE(other.owns_lock());
+  other.unlock();
+  EXPECT_TRUE(lock.try_lock());
+  lock.unlock();
+}
+
+// Coroutines started on many threads all complete, with writers mutually
+// excluded.
+TEST(AsyncRWLockTest, TestMultipleThreads) {
+  rwlock::AsyncRWLock lock;
+  const int num_threads = 4;
+  const int iterations = 1000;
+  int counter = 0;
+  std::atomic<int> in_writer{0};
+  std::atomic<int> completed{0};
+
+  auto writer = [&]() -> Task {
+    rwlock::AsyncUniqueLock guard = co_await lock.exclusive();
+    EXPECT_EQ(in_writer.fetch_add(1), 0);
+    ++counter;
+    in_writer.fetch_sub(1);
+    completed.fetch_add(1);
+  };
+  auto reader = [&]() -> Task {
+    rwlock::AsyncSharedLock guard = co_await lock.shared();
+    EXPECT_EQ(in_writer.load(), 0);
+    completed.fetch_add(1);
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.emplace_back([&]() {
+      for (int j = 0; j < iterations; ++j) {
+        writer();
+        reader();
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  EXPECT_EQ(completed.load(), 2 * num_threads * iterations);
+  EXPECT_EQ(counter, num_threads * iterations);
+}
@@ -0,0 +1,124 @@
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <thread>
+
+#include "rwlock/biased_lock.h"
+#include "rwlock/futex_rw_lock.h"
+#include "rwlock/shared_lock.h"
+#include "rwlock/tests/counter_test.h"
+#include "rwlock/unique_lock.h"
+
+// The owner locks without touching the underlying lock.
+TEST(BiasedLockTest, TestOwnerFastPath) {
+  rwlock::BiasedLock<> lock;
+  ASSERT_TRUE(lock.biased());
+
+  ASSERT_EQ(lock.lock(), 0);
+  ASSERT_EQ(lock.lock(), EDEADLK);
+  ASSERT_EQ(lock.try_lock_shared(), EDEADLK);
+  ASSERT_EQ(lock.underlying().try_lock(), 0);
+  ASSERT_TRUE(lock.underlying().unlock());
+  ASSERT_TRUE(lock.unlock());
+
+  ASSERT_EQ(lock.lock_shared(), 0);
+  ASSERT_EQ(lock.lock_shared(), 0);
+  ASSERT_EQ(lock.try_lock(), EDEADLK);
+  ASSERT_TRUE(lock.unlock_shared());
+  ASSERT_TRUE(lock.unlock_shared());
+  ASSERT_TRUE(lock.biased());
+}
+
+// Another thread revokes the reservation once the owner is out; afterwards
+// everybody goes through the underlying lock.
+TEST(BiasedLockTest, TestRevocation) {
+  rwlock::BiasedLock<rwlock::FutexRWLock> lock;
+  ASSERT_EQ(lock.lock(), 0);
+
+  std::thread other([&] { ASSERT_EQ(lock.try_lock(), EBUSY); });
+  other.join();
+  ASSERT_TRUE(lock.biased());
+
+  std::atomic<bool> other_in{false};
+  other = std::thread([&] {
+    rwlock::BasicUniqueLock<rwlock::BiasedLock<rwlock::FutexRWLock>> guard(
+        lock);
+    other_in.store(true);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ASSERT_FALSE(other_in.load());
+  ASSERT_TRUE(lock.unlock());
+  other.join();
+  ASSERT_TRUE(other_in.load());
+  ASSERT_FALSE(lock.biased());
+
+  // The owner now takes the underlying lock too.
+  ASSERT_EQ(lock.lock_shared(), 0);
+  ASSERT_EQ(lock.underlying().try_lock(), EBUSY);
+  ASSERT_TRUE(lock.unlock_shared());
+  ASSERT_EQ(lock.underlying().try_lock(), 0);
+  ASSERT_TRUE(lock.underlying().unlock());
+}
+
+// A try_lock from another thread that finds the owner inside raises the
+// revocation flag before it backs off. An owner entering meanwhile waits for
+// the flag to drop instead of revoking its own reservation, so the bias ends
+// only if some try_lock wins.
+TEST(BiasedLockTest, TestFailedTryRevokeKeepsBias) {
+  rwlock::BiasedLock<> lock;
+  const int kOwnerIters = 20000;
+  std::atomic<bool> inside{false};
+  std::atomic<bool> done{false};
+  std::atomic<int> won{0};
+
+  std::thread other([&] {
+    while (!done.load() && won.load() == 0) {
+      if (!inside.load()) {
+        continue;
+      }
+      if (lock.try_lock() == 0) {
+        won.fetch_add(1);
+        lock.unlock();
+      }
+    }
+  });
+  int failures = 0;
+  for (int i = 0; i < kOwnerIters; ++i) {
+    if (lock.lock() != 0) {
+      ++failures;
+      continue;
+    }
+    inside.store(true);
+    for (int j = 0; j < 100; ++j) {
+      inside.load();
+    }
+    inside.store(false);
+    if (!lock.unlock()) {
+      ++failures;
+    }
+  }
+  done.store(true);
+  other.join();
+  ASSERT_EQ(failures, 0);
+  ASSERT_EQ(lock.biased(), won.load() == 0);
+}
+
+// A lock reserved for another thread is revoked on first use.
+TEST(BiasedLockTest, TestReservedForOtherThread) {
+  std::thread::id owner;
+  std::thread([&] { owner = std::this_thread::get_id(); }).join();
+  rwlock::BiasedLock<> lock(owner);
+  ASSERT_TRUE(lock.biased());
+  ASSERT_EQ(lock.try_lock(), 0);
+  ASSERT_FALSE(lock.biased());
+  ASSERT_TRUE(lock.unlock());
+}
+
+// None of the contending threads is the owner, so the first one in revokes
+// the bias and they all share the underlying lock.
+TEST(BiasedLockTest, TestContention) {
+  rwlock::BiasedLock<> lock;
+  run_counter_test<rwlock::BiasedLock<>, 4, 2000>(lock);
+  ASSERT_FALSE(lock.biased());
+}
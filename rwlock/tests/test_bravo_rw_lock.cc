@@ -0,0 +1,91 @@
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <thread>
+
+#include "rwlock/bravo_rw_lock.h"
+#include "rwlock/futex_rw_lock.h"
+#include "rwlock/shared_lock.h"
+#include "rwlock/tests/counter_test.h"
+#include "rwlock/unique_lock.h"
+
+// The first reader goes through the underlying lock and turns the bias on;
+// later readers bypass it.
+TEST(BravoRWLockTest, TestReadBias) {
+  rwlock::BravoRWLock<> lock;
+  ASSERT_FALSE(lock.read_biased());
+
+  ASSERT_EQ(lock.lock_shared(), 0);
+  ASSERT_TRUE(lock.read_biased());
+  ASSERT_TRUE(lock.unlock_shared());
+
+  ASSERT_EQ(lock.lock_shared(), 0);
+  // Fast path: the underlying lock is free.
+  ASSERT_EQ(lock.underlying().try_lock(), 0);
+  ASSERT_TRUE(lock.underlying().unlock());
+  ASSERT_EQ(lock.try_lock(), EBUSY);
+  ASSERT_TRUE(lock.read_biased());
+  ASSERT_TRUE(lock.unlock_shared());
+
+  // A writer revokes the bias, and it stays off for a while.
+  ASSERT_EQ(lock.lock(), 0);
+  ASSERT_FALSE(lock.read_biased());
+  ASSERT_EQ(lock.try_lock_shared(), EBUSY);
+  ASSERT_TRUE(lock.unlock());
+}
+
+// Nested read locks on one thread share a slot; the extra one uses the
+// underlying lock.
+TEST(BravoRWLockTest, TestNestedReaders) {
+  rwlock::BravoRWLock<rwlock::FutexRWLock> lock;
+  ASSERT_EQ(lock.lock_shared(), 0);
+  ASSERT_TRUE(lock.unlock_shared());
+
+  ASSERT_EQ(lock.lock_shared(), 0);
+  ASSERT_EQ(lock.try_lock_shared(), 0);
+  ASSERT_EQ(lock.underlying().try_lock(), EBUSY);
+  ASSERT_TRUE(lock.unlock_shared());
+  ASSERT_TRUE(lock.unlock_shared());
+  ASSERT_EQ(lock.try_lock(), 0);
+  ASSERT_TRUE(lock.unlock());
+}
+
+// A writer waits for fast-path readers to leave.
+TEST(BravoRWLockTest, TestWriterWaitsForVisibleReaders) {
+  rwlock::BravoRWLock<> lock;
+  ASSERT_EQ(lock.lock_shared(), 0);
+  ASSERT_TRUE(lock.unlock_shared());
+  ASSERT_TRUE(lock.read_biased());
+
+  std::atomic<bool> reader_in{false};
+  std::atomic<bool> release{false};
+  std::thread reader([&] {
+    rwlock::BasicSharedLock<rwlock::BravoRWLock<>> guard(lock);
+    reader_in.store(true);
+    while (!release.load()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  });
+  while (!reader_in.load()) {
+    std::this_thread::yield();
+  }
+
+  std::atomic<bool> writer_in{false};
+  std::thread writer([&] {
+    rwlock::BasicUniqueLock<rwlock::BravoRWLock<>> guard(lock);
+    writer_in.store(true);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ASSERT_FALSE(writer_in.load());
+  release.store(true);
+  reader.join();
+  writer.join();
+  ASSERT_TRUE(writer_in.load());
+}
+
+// The bias flips on and off as writers come and go.
+TEST(BravoRWLockTest, TestContention) {
+  rwlock::BravoRWLock<> lock;
+  run_counter_test<rwlock::BravoRWLock<>, 8, 3200, 16>(lock);
+}
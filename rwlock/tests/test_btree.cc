@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "rwlock/btree.h"
+
+TEST(BTreeTest, TestInsertLookupErase) {
+  rwlock::BTree<int, int, 8> tree;
+  const int n = 20000;
+
+  std::vector<int> keys(n);
+  for (int i = 0; i < n; ++i) {
+    keys[i] = i;
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(42));
+
+  for (int key : keys) {
+    tree.insert(key, key * 10);
+  }
+  for (int i = 0; i < n; ++i) {
+    ASSERT_EQ(tree.lookup(i), i * 10);
+  }
+  EXPECT_FALSE(tree.lookup(-1).has_value());
+  EXPECT_FALSE(tree.lookup(n).has_value());
+
+  // Overwrite.
+  tree.insert(5, 55);
+  EXPECT_EQ(tree.lookup(5), 55);
+  tree.insert(5, 50);
+
+  for (int i = 0; i < n; i += 2) {
+    ASSERT_TRUE(tree.erase(i));
+  }
+  EXPECT_FALSE(tree.erase(0));
+  for (int i = 0; i < n; ++i) {
+    if (i % 2 == 0) {
+      ASSERT_FALSE(tree.lookup(i).has_value());
+    } else {
+      ASSERT_EQ(tree.lookup(i), i * 10);
+    }
+  }
+}
+
+// The node latch excludes writers while held shared and reports conflicting
+// writes to optimistic readers.
+TEST(BTreeTest, TestVersionedLatch) {
+  rwlock::VersionedLatch latch;
+  bool restart = false;
+  std::uint64_t version = latch.read_lock_or_restart(restart);
+  ASSERT_FALSE(restart);
+  latch.read_unlock_or_restart(version, restart);
+  EXPECT_FALSE(restart);
+
+  std::uint64_t write_version = version;
+  latch.upgrade_to_write_lock_or_restart(write_version, restart);
+  ASSERT_FALSE(restart);
+  latch.write_unlock();
+
+  latch.read_unlock_or_restart(version, restart);
+  EXPECT_TRUE(restart);
+
+  // A stale version cannot be upgraded.
+  restart = false;
+  latch.upgrade_to_write_lock_or_restart(version, restart);
+  EXPECT_TRUE(restart);
+}
+
+// Concurrent writers on disjoint keys with optimistic readers running.
+TEST(BTreeTest, TestConcurrentInsertAndLookup) {
+  rwlock::BTree<std::int64_t, std::int64_t, 16> tree;
+  const int num_writers = 4;
+  const int per_writer = 20000;
+  std::atomic<bool> keep_reading{true};
+
+  auto reader_func = [&]() {
+    std::mt19937 rng(7);
+    while (keep_reading.load(std::memory_order_relaxed)) {
+      std::int64_t key = rng() % (num_writers * per_writer);
+      std::optional<std::int64_t> value = tree.lookup(key);
+      if (value) {
+        ASSERT_EQ(*value, key * 3);
+      }
+    }
+  };
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 2; ++i) {
+    readers.emplace_back(reader_func);
+  }
+  std::vector<std::thread> writers;
+  for (int w = 0; w < num_writers; ++w) {
+    writers.emplace_back([&, w]() {
+      for (std::int64_t i = w; i < num_writers * per_writer; i += num_writers) {
+        tree.insert(i, i * 3);
+      }
+    });
+  }
+  for (auto &t : writers) {
+    t.join();
+  }
+  keep_reading.store(false);
+  for (auto &t : readers) {
+    t.join();
+  }
+
+  for (std::int64_t i = 0; i < num_writers * per_writer; ++i) {
+    ASSERT_EQ(tree.lookup(i), i * 3);
+  }
+}
@@ -0,0 +1,150 @@
+#include <atomic>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rwlock/concurrent_hash_map.h"
+
+TEST(ConcurrentHashMapTest, TestInsertFindErase) {
+  rwlock::ConcurrentHashMap<std::string, int> map(4);
+
+  EXPECT_TRUE(map.insert("one", 1));
+  EXPECT_TRUE(map.insert("two", 2));
+  EXPECT_FALSE(map.insert("one", 100));
+  EXPECT_EQ(map.find("one"), 1);
+  EXPECT_FALSE(map.insert_or_assign("one", 11));
+  EXPECT_EQ(map.find("one"), 11);
+  EXPECT_TRUE(map.contains("two"));
+  EXPECT_FALSE(map.find("three").has_value());
+  EXPECT_EQ(map.size(), 2u);
+
+  EXPECT_TRUE(map.erase("one"));
+  EXPECT_FALSE(map.erase("one"));
+  EXPECT_FALSE(map.contains("one"));
+  EXPECT_EQ(map.find("two"), 2);
+  EXPECT_EQ(map.size(), 1u);
+}
+
+// Shards grow online and erased slots are reused.
+TEST(ConcurrentHashMapTest, TestGrowAndReuseTombstones) {
+  rwlock::ConcurrentHashMap<int, int> map(2);
+  const int n = 10000;
+
+  for (int i = 0; i < n; ++i) {
+    ASSERT_TRUE(map.insert(i, i * 2));
+  }
+  EXPECT_EQ(map.size(), static_cast<size_t>(n));
+  for (int round = 0; round < 3; ++round) {
+    for (int i = 0; i < n; i += 2) {
+      ASSERT_TRUE(map.erase(i));
+    }
+    for (int i = 0; i < n; i += 2) {
+      ASSERT_TRUE(map.insert(i, i * 2));
+    }
+  }
+  for (int i = 0; i < n; ++i) {
+    ASSERT_EQ(map.find(i), i * 2);
+  }
+
+  long sum = 0;
+  size_t count = 0;
+  map.for_each([&](const int &key, const int &value) {
+    EXPECT_EQ(value, key * 2);
+    sum += key;
+    ++count;
+  });
+  EXPECT_EQ(count, static_cast<size_t>(n));
+  EXPECT_EQ(sum, static_cast<long>(n) * (n - 1) / 2);
+}
+
+TEST(ConcurrentHashMapTest, TestReserve) {
+  rwlock::ConcurrentHashMap<int, int> map(8, 1000);
+  map.reserve(5000);
+  for (int i = 0; i < 5000; ++i) {
+    ASSERT_TRUE(map.insert(i, i));
+  }
+  EXPECT_EQ(map.size(), 5000u);
+  EXPECT_EQ(map.shard_count(), 8u);
+}
+
+// for_each_shard calls f once per shard, with a view of that shard's
+// entries.
+TEST(ConcurrentHashMapTest, TestForEachShard) {
+  rwlock::ConcurrentHashMap<int, int> map(8);
+  const int n = 1000;
+  for (int i = 0; i < n; ++i) {
+    ASSERT_TRUE(map.insert(i, i * 2));
+  }
+  for (int i = 0; i < n; i += 3) {
+    ASSERT_TRUE(map.erase(i));
+  }
+
+  size_t calls = 0;
+  size_t total = 0;
+  std::vector<int> seen(n, 0);
+  map.for_each_shard([&](const auto &shard) {
+    ++calls;
+    size_t count = 0;
+    for (const auto &[key, value] : shard) {
+      EXPECT_EQ(value, key * 2);
+      ++seen[key];
+      ++count;
+    }
+    EXPECT_EQ(count, shard.size());
+    total += count;
+  });
+  EXPECT_EQ(calls, map.shard_count());
+  EXPECT_EQ(total, map.size());
+  for (int i = 0; i < n; ++i) {
+    EXPECT_EQ(seen[i], i % 3 == 0 ? 0 : 1);
+  }
+}
+
+// Writers on disjoint keys and concurrent readers.
+TEST(ConcurrentHashMapTest, TestConcurrentAccess) {
+  rwlock::ConcurrentHashMap<int, int> map;
+  const int num_writers = 4;
+  const int per_writer = 5000;
+  std::atomic<bool> keep_reading{true};
+
+  std::thread reader([&]() {
+    while (keep_reading.load(std::memory_order_relaxed)) {
+      for (int i = 0; i < 100; ++i) {
+        std::optional<int> value = map.find(i);
+        if (value) {
+          ASSERT_EQ(*value, i + 1);
+        }
+      }
+    }
+  });
+
+  std::vector<std::thread> writers;
+  for (int w = 0; w < num_writers; ++w) {
+    writers.emplace_back([&, w]() {
+      for (int i = w; i < num_writers * per_writer; i += num_writers) {
+        ASSERT_TRUE(map.insert(i, i + 1));
+        if (i % 3 == 0) {
+          ASSERT_TRUE(map.erase(i));
+        }
+      }
+    });
+  }
+  for (auto &t : writers) {
+    t.join();
+  }
+  keep_reading.store(false);
+  reader.join();
+
+  size_t expected = 0;
+  for (int i = 0; i < num_writers * per_writer; ++i) {
+    if (i % 3 != 0) {
+      ++expected;
+      ASSERT_EQ(map.find(i), i + 1);
+    } else {
+      ASSERT_FALSE(map.contains(i));
+    }
+  }
+  EXPECT_EQ(map.size(), expected);
+}
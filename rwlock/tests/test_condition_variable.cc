@@ -0,0 +1,204 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <gtest/gtest.h>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "rwlock/condition_variable.h"
+#include "rwlock/futex_rw_lock.h"
+#include "rwlock/rw_lock.h"
+#include "rwlock/shared_lock.h"
+#include "rwlock/unique_lock.h"
+
+// A batch published with notify_all reaches every consumer, whether they wait
+// in shared or exclusive mode.
+template <class Lock> static void run_broadcast_test() {
+  Lock lock;
+  rwlock::RWConditionVariable cv;
+  int published = 0;
+  std::atomic<int> consumed{0};
+  const int kConsumers = 8;
+
+  std::vector<std::thread> consumers;
+  for (int i = 0; i < kConsumers; ++i) {
+    consumers.emplace_back([&, i] {
+      if (i % 2 == 0) {
+        rwlock::BasicSharedLock<Lock> guard(lock);
+        cv.wait(guard, [&] { return published != 0; });
+        ASSERT_TRUE(guard.owns_lock());
+      } else {
+        rwlock::BasicUniqueLock<Lock> guard(lock);
+        cv.wait(guard, [&] { return published != 0; });
+        ASSERT_TRUE(guard.owns_lock());
+      }
+      consumed.fetch_add(1);
+    });
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  {
+    rwlock::BasicUniqueLock<Lock> guard(lock);
+    published = 1;
+    cv.notify_all();
+  }
+  for (auto &t : consumers) {
+    t.join();
+  }
+  ASSERT_EQ(consumed.load(), kConsumers);
+
+  // The lock is left free for others.
+  ASSERT_EQ(lock.try_lock(), 0);
+  lock.unlock();
+}
+
+TEST(RWConditionVariableTest, TestNotifyAllRequeue) {
+  run_broadcast_test<rwlock::FutexRWLock>();
+}
+
+TEST(RWConditionVariableTest, TestNotifyAllWakeAll) {
+  run_broadcast_test<rwlock::RWLock>();
+}
+
+// notify_all while not holding the lock still wakes every waiter.
+TEST(RWConditionVariableTest, TestNotifyAllUnlocked) {
+  rwlock::FutexRWLock lock;
+  rwlock::RWConditionVariable cv;
+  std::atomic<bool> ready{false};
+  std::atomic<int> woken{0};
+
+  std::vector<std::thread> waiters;
+  for (int i = 0; i < 4; ++i) {
+    waiters.emplace_back([&] {
+      rwlock::BasicUniqueLock<rwlock::FutexRWLock> guard(lock);
+      cv.wait(guard, [&] { return ready.load(); });
+      woken.fetch_add(1);
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ready.store(true);
+  cv.notify_all();
+  for (auto &t : waiters) {
+    t.join();
+  }
+  ASSERT_EQ(woken.load(), 4);
+}
+
+// Waiters requeued by notify_all are let in one release at a time: each
+// release of the lock wakes at most one of them, so no more than two (the one
+// notify_all wakes itself and the one the notifier's unlock wakes) ever hold
+// the lock together, even though all of them wait in shared mode.
+TEST(RWConditionVariableTest, TestNotifyAllWakesOnePerRelease) {
+  rwlock::FutexRWLock lock;
+  rwlock::RWConditionVariable cv;
+  bool ready = false;
+  std::atomic<int> inside{0};
+  std::atomic<int> max_inside{0};
+  std::atomic<int> woken{0};
+  const int kWaiters = 8;
+
+  std::vector<std::thread> waiters;
+  for (int i = 0; i < kWaiters; ++i) {
+    waiters.emplace_back([&] {
+      rwlock::BasicSharedLock<rwlock::FutexRWLock> guard(lock);
+      cv.wait(guard, [&] { return ready; });
+      const int n = inside.fetch_add(1) + 1;
+      int max = max_inside.load();
+      while (n > max && !max_inside.compare_exchange_weak(max, n)) {
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      inside.fetch_sub(1);
+      woken.fetch_add(1);
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  {
+    rwlock::BasicUniqueLock<rwlock::FutexRWLock> guard(lock);
+    ready = true;
+    cv.notify_all();
+  }
+  for (auto &t : waiters) {
+    t.join();
+  }
+  ASSERT_EQ(woken.load(), kWaiters);
+  ASSERT_LE(max_inside.load(), 2);
+}
+
+// A condition variable stays bound to the lock of its first wait.
+TEST(RWConditionVariableTest, TestBoundToOneLock) {
+  rwlock::FutexRWLock lock;
+  rwlock::FutexRWLock other;
+  rwlock::RWConditionVariable cv;
+  {
+    rwlock::BasicUniqueLock<rwlock::FutexRWLock> guard(lock);
+    cv.wait_for(guard, std::chrono::milliseconds(1));
+  }
+  rwlock::BasicUniqueLock<rwlock::FutexRWLock> guard(other);
+  ASSERT_THROW(cv.wait_for(guard, std::chrono::milliseconds(1)),
+               std::system_error);
+  ASSERT_TRUE(guard.owns_lock());
+}
+
+// notify_one hands items to a single consumer at a time.
+TEST(RWConditionVariableTest, TestNotifyOne) {
+  rwlock::RWLock lock;
+  rwlock::RWConditionVariable cv;
+  int items = 0;
+  int taken = 0;
+  const int kItems = 100;
+
+  std::thread consumer([&] {
+    rwlock::UniqueLock guard(lock);
+    while (taken < kItems) {
+      cv.wait(guard, [&] { return items > 0; });
+      --items;
+      ++taken;
+    }
+  });
+  for (int i = 0; i < kItems; ++i) {
+    rwlock::UniqueLock guard(lock);
+    ++items;
+    cv.notify_one();
+  }
+  consumer.join();
+  ASSERT_EQ(taken, kItems);
+}
+
+// Timed waits give up and return with the lock held.
+TEST(RWConditionVariableTest, TestWaitTimeout) {
+  rwlock::FutexRWLock lock;
+  rwlock::RWConditionVariable cv;
+  rwlock::BasicSharedLock<rwlock::FutexRWLock> guard(lock);
+
+  const auto start = std::chrono::steady_clock::now();
+  ASSERT_EQ(cv.wait_for(guard, std::chrono::milliseconds(10)),
+            std::cv_status::timeout);
+  ASSERT_GE(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(10));
+  ASSERT_TRUE(guard.owns_lock());
+
+  ASSERT_FALSE(cv.wait_until(
+      guard, std::chrono::system_clock::now() + std::chrono::milliseconds(5),
+      [] { return false; }));
+  ASSERT_TRUE(guard.owns_lock());
+}
+
+// A timed wait with a predicate returns true once notified.
+TEST(RWConditionVariableTest, TestWaitForNotified) {
+  rwlock::FutexRWLock lock;
+  rwlock::RWConditionVariable cv;
+  bool flag = false;
+
+  std::thread notifier([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    rwlock::BasicUniqueLock<rwlock::FutexRWLock> guard(lock);
+    flag = true;
+    cv.notify_all();
+  });
+  rwlock::BasicUniqueLock<rwlock::FutexRWLock> guard(lock);
+  ASSERT_TRUE(
+      cv.wait_for(guard, std::chrono::seconds(10), [&] { return flag; }));
+  guard.unlock();
+  notifier.join();
+}
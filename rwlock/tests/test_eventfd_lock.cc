@@ -0,0 +1,114 @@
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <system_error>
+#include <thread>
+
+#include "rwlock/eventfd_lock.h"
+#include "rwlock/multi_lock.h"
+#include "rwlock/wait_queue_rw_lock.h"
+
+#include <poll.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+namespace {
+
+bool readable(int fd, int timeout_ms) {
+  pollfd pfd{fd, POLLIN, 0};
+  return poll(&pfd, 1, timeout_ms) == 1 && (pfd.revents & POLLIN) != 0;
+}
+
+} // namespace
+
+// A free lock is granted at once and the fd is readable right away.
+TEST(EventFdLockRequestTest, TestImmediateGrant) {
+  rwlock::WaitQueueRWLock lock;
+  rwlock::EventFdLockRequest request(lock, rwlock::LockMode::kShared);
+  ASSERT_TRUE(request.granted());
+  ASSERT_TRUE(readable(request.fd(), 0));
+
+  auto guard = request.take_shared();
+  ASSERT_TRUE(guard.owns_lock());
+  ASSERT_EQ(lock.try_lock(), EBUSY);
+  ASSERT_THROW(request.take_shared(), std::system_error);
+  guard.unlock();
+  ASSERT_EQ(lock.try_lock(), 0);
+  lock.unlock();
+}
+
+// A queued request signals through epoll when the holder releases.
+TEST(EventFdLockRequestTest, TestEpollSignal) {
+  rwlock::WaitQueueRWLock lock;
+  ASSERT_EQ(lock.lock_shared(), 0);
+
+  rwlock::EventFdLockRequest request(lock, rwlock::LockMode::kExclusive);
+  ASSERT_FALSE(request.granted());
+  ASSERT_FALSE(readable(request.fd(), 0));
+  ASSERT_THROW(request.take_unique(), std::system_error);
+
+  const int epfd = epoll_create1(EPOLL_CLOEXEC);
+  ASSERT_GE(epfd, 0);
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.u64 = 99;
+  ASSERT_EQ(epoll_ctl(epfd, EPOLL_CTL_ADD, request.fd(), &event), 0);
+
+  std::thread holder([&] { lock.unlock_shared(); });
+  epoll_event ready{};
+  ASSERT_EQ(epoll_wait(epfd, &ready, 1, 10000), 1);
+  ASSERT_EQ(ready.data.u64, 99u);
+  holder.join();
+  close(epfd);
+
+  ASSERT_TRUE(request.granted());
+  ASSERT_THROW(request.take_shared(), std::system_error); // wrong mode
+  auto guard = request.take_unique();
+  ASSERT_TRUE(guard.owns_lock());
+  ASSERT_EQ(lock.try_lock_shared(), EBUSY);
+}
+
+// Dropping a request withdraws it, releasing a lock granted but not taken.
+TEST(EventFdLockRequestTest, TestDestroyWithdraws) {
+  rwlock::WaitQueueRWLock lock;
+  ASSERT_EQ(lock.lock(), 0);
+  {
+    rwlock::EventFdLockRequest queued(lock, rwlock::LockMode::kExclusive);
+    ASSERT_FALSE(queued.granted());
+  }
+  ASSERT_TRUE(lock.unlock());
+
+  {
+    rwlock::EventFdLockRequest granted(lock, rwlock::LockMode::kExclusive);
+    ASSERT_TRUE(granted.granted());
+    ASSERT_EQ(lock.try_lock_shared(), EBUSY);
+  }
+  ASSERT_EQ(lock.try_lock(), 0);
+  ASSERT_TRUE(lock.unlock());
+}
+
+// Requests and blocking lockers share one FIFO queue.
+TEST(EventFdLockRequestTest, TestMixedWithBlocking) {
+  rwlock::WaitQueueRWLock lock;
+  ASSERT_EQ(lock.lock(), 0);
+  rwlock::EventFdLockRequest first(lock, rwlock::LockMode::kShared);
+  rwlock::EventFdLockRequest second(lock, rwlock::LockMode::kShared);
+
+  ASSERT_TRUE(lock.unlock());
+  ASSERT_TRUE(readable(first.fd(), 1000));
+  ASSERT_TRUE(readable(second.fd(), 1000));
+  auto a = first.take_shared();
+  auto b = second.take_shared();
+
+  std::atomic<bool> writer_done{false};
+  std::thread writer([&] {
+    rwlock::BasicUniqueLock<rwlock::WaitQueueRWLock> guard(lock);
+    writer_done.store(true);
+  });
+  a.unlock();
+  ASSERT_FALSE(writer_done.load());
+  b.unlock();
+  writer.join();
+  ASSERT_TRUE(writer_done.load());
+}
@@ -0,0 +1,170 @@
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <map>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "rwlock/flat_combining.h"
+#include "rwlock/rw_lock.h"
+#include "rwlock/shared_lock.h"
+
+// Every submitted update runs exactly once and under the exclusive lock.
+TEST(FlatCombinerTest, TestMultipleWriters) {
+  rwlock::RWLock lock;
+  rwlock::FlatCombiner combiner(lock);
+  const int num_threads = 8;
+  const int iterations = 2000;
+  long counter = 0;
+  std::map<int, int> per_thread;
+  std::atomic<int> in_update{0};
+
+  auto writer_func = [&](int idx) {
+    for (int i = 0; i < iterations; ++i) {
+      combiner.apply([&]() {
+        EXPECT_EQ(in_update.fetch_add(1), 0);
+        ++counter;
+        ++per_thread[idx];
+        in_update.fetch_sub(1);
+      });
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.emplace_back(writer_func, i);
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  EXPECT_EQ(counter, num_threads * iterations);
+  ASSERT_EQ(per_thread.size(), static_cast<size_t>(num_threads));
+  for (const auto &entry : per_thread) {
+    EXPECT_EQ(entry.second, iterations);
+  }
+}
+
+// Readers using SharedLock never observe a half-applied update.
+TEST(FlatCombinerTest, TestReadersSeeWholeUpdates) {
+  rwlock::RWLock lock;
+  rwlock::FlatCombiner combiner(lock);
+  int first = 0;
+  int second = 0;
+  std::atomic<bool> keep_reading{true};
+
+  std::thread reader([&]() {
+    while (keep_reading.load(std::memory_order_relaxed)) {
+      rwlock::SharedLock shared_lock(*combiner.rwlock());
+      ASSERT_EQ(first, second);
+    }
+  });
+
+  std::vector<std::thread> writers;
+  for (int i = 0; i < 4; ++i) {
+    writers.emplace_back([&]() {
+      for (int j = 0; j < 1000; ++j) {
+        combiner.apply([&]() {
+          ++first;
+          ++second;
+        });
+      }
+    });
+  }
+  for (auto &t : writers) {
+    t.join();
+  }
+  keep_reading.store(false);
+  reader.join();
+
+  EXPECT_EQ(first, 4000);
+  EXPECT_EQ(second, 4000);
+}
+
+// A const lvalue callable is accepted and run as is.
+TEST(FlatCombinerTest, TestConstCallable) {
+  rwlock::RWLock lock;
+  rwlock::FlatCombiner combiner(lock);
+  int x = 0;
+  const auto f = [&x] { ++x; };
+  combiner.apply(f);
+  combiner.apply(f);
+  ASSERT_EQ(x, 2);
+}
+
+// An exception thrown by an update is rethrown to the thread that submitted
+// it, even when another thread ran it.
+TEST(FlatCombinerTest, TestExceptionPropagates) {
+  rwlock::RWLock lock;
+  rwlock::FlatCombiner combiner(lock);
+
+  EXPECT_THROW(combiner.apply([]() { throw std::runtime_error("update"); }),
+               std::runtime_error);
+
+  int value = 0;
+  combiner.apply([&]() { value = 1; });
+  EXPECT_EQ(value, 1);
+  EXPECT_EQ(lock.try_lock(), 0);
+  lock.unlock();
+}
+
+// RWLock whose lock() fails with EDEADLK on threads that set fail_lock.
+class FailingLock {
+public:
+  int lock() { return fail_lock ? EDEADLK : lock_.lock(); }
+  int try_lock() { return fail_lock ? EDEADLK : lock_.try_lock(); }
+  bool unlock() { return lock_.unlock(); }
+
+  static thread_local bool fail_lock;
+
+private:
+  rwlock::RWLock lock_;
+};
+
+thread_local bool FailingLock::fail_lock = false;
+
+// A writer whose combine fails withdraws its own request before another
+// combiner can run it: each of its updates either runs once or is thrown
+// back, never both, while the other writers keep combining.
+TEST(FlatCombinerTest, TestLockFailureWhileOthersCombine) {
+  FailingLock lock;
+  rwlock::BasicFlatCombiner<FailingLock> combiner(lock);
+  const int num_threads = 4;
+  const int iterations = 20000;
+  long counter = 0;
+  int failing_runs = 0;
+  int failing_throws = 0;
+
+  auto writer_func = [&]() {
+    for (int i = 0; i < iterations; ++i) {
+      combiner.apply([&]() { ++counter; });
+    }
+  };
+  auto failing_func = [&]() {
+    FailingLock::fail_lock = true;
+    for (int i = 0; i < iterations; ++i) {
+      try {
+        combiner.apply([&]() { ++failing_runs; });
+      } catch (const std::system_error &e) {
+        EXPECT_EQ(e.code().value(), EDEADLK);
+        ++failing_throws;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.emplace_back(writer_func);
+  }
+  threads.emplace_back(failing_func);
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  EXPECT_EQ(counter, num_threads * iterations);
+  EXPECT_EQ(failing_runs + failing_throws, iterations);
+  EXPECT_GT(failing_throws, 0);
+}
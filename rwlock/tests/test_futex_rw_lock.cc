@@ -0,0 +1,151 @@
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <stop_token>
+#include <thread>
+
+#include "rwlock/futex_rw_lock.h"
+#include "rwlock/shared_lock.h"
+#include "rwlock/tests/counter_test.h"
+#include "rwlock/unique_lock.h"
+#include "rwlock/wait_strategy.h"
+
+// Basic exclusive and shared state transitions.
+TEST(FutexRWLockTest, TestTryLock) {
+  rwlock::FutexRWLock lock;
+
+  ASSERT_EQ(lock.try_lock(), 0);
+  ASSERT_EQ(lock.try_lock(), EBUSY);
+  ASSERT_EQ(lock.try_lock_shared(), EBUSY);
+  ASSERT_TRUE(lock.unlock());
+
+  ASSERT_EQ(lock.try_lock_shared(), 0);
+  ASSERT_EQ(lock.try_lock_shared(), 0);
+  ASSERT_EQ(lock.try_lock(), EBUSY);
+  ASSERT_TRUE(lock.unlock_shared());
+  ASSERT_TRUE(lock.unlock());
+  ASSERT_EQ(lock.try_lock(), 0);
+  ASSERT_TRUE(lock.unlock());
+}
+
+// Unlocking a lock that is not held reports failure.
+TEST(FutexRWLockTest, TestUnlockNotHeld) {
+  rwlock::FutexRWLock lock;
+  ASSERT_FALSE(lock.unlock());
+  ASSERT_FALSE(lock.unlock_shared());
+}
+
+// A waiting writer holds off new readers.
+TEST(FutexRWLockTest, TestWriterPreference) {
+  rwlock::FutexRWLock lock;
+  ASSERT_EQ(lock.lock_shared(), 0);
+
+  std::atomic<bool> writer_done{false};
+  std::thread writer([&] {
+    ASSERT_EQ(lock.lock(), 0);
+    writer_done.store(true);
+    lock.unlock();
+  });
+
+  // Wait for the writer to announce itself.
+  while (lock.try_lock_shared() == 0) {
+    lock.unlock_shared();
+    std::this_thread::yield();
+  }
+  ASSERT_FALSE(writer_done.load());
+  ASSERT_TRUE(lock.unlock_shared());
+  writer.join();
+  ASSERT_TRUE(writer_done.load());
+  ASSERT_EQ(lock.try_lock_shared(), 0);
+  lock.unlock_shared();
+}
+
+TEST(FutexRWLockTest, TestContentionDefaultWait) {
+  rwlock::BasicFutexRWLock<rwlock::DefaultWait> lock;
+  run_counter_test<decltype(lock), 4, 2000>(lock);
+}
+
+TEST(FutexRWLockTest, TestContentionParkWait) {
+  rwlock::BasicFutexRWLock<rwlock::ParkWait> lock;
+  run_counter_test<decltype(lock), 4, 2000>(lock);
+}
+
+TEST(FutexRWLockTest, TestContentionYieldWait) {
+  rwlock::BasicFutexRWLock<rwlock::YieldWait> lock;
+  run_counter_test<decltype(lock), 4, 2000>(lock);
+}
+
+// The guards' timed paths take a wait strategy.
+TEST(FutexRWLockTest, TestGuardTimedLock) {
+  rwlock::FutexRWLock lock;
+  rwlock::BasicUniqueLock<rwlock::FutexRWLock> writer(lock);
+
+  std::thread t([&] {
+    rwlock::BasicSharedLock<rwlock::FutexRWLock> reader(lock,
+                                                        std::try_to_lock);
+    ASSERT_FALSE(reader.owns_lock());
+    ASSERT_FALSE(reader.try_lock_for(std::chrono::milliseconds(5),
+                                     rwlock::YieldWait()));
+    ASSERT_TRUE(reader.try_lock_for(std::chrono::seconds(10),
+                                    rwlock::BackoffWait<>()));
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  writer.unlock();
+  t.join();
+  ASSERT_EQ(lock.try_lock(), 0);
+  lock.unlock();
+}
+
+// Blocked acquisitions return ECANCELED once stop is requested, and leave the
+// lock usable.
+TEST(FutexRWLockTest, TestStopToken) {
+  rwlock::FutexRWLock lock;
+  ASSERT_EQ(lock.lock(), 0);
+
+  std::stop_source source;
+  std::atomic<int> cancelled{0};
+  std::thread writer([&] {
+    if (lock.lock(source.get_token()) == ECANCELED) {
+      cancelled.fetch_add(1);
+    }
+  });
+  std::thread reader([&] {
+    if (lock.lock_shared(source.get_token()) == ECANCELED) {
+      cancelled.fetch_add(1);
+    }
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  source.request_stop();
+  writer.join();
+  reader.join();
+  ASSERT_EQ(cancelled.load(), 2);
+
+  // The cancelled writer no longer holds readers off.
+  ASSERT_TRUE(lock.unlock());
+  ASSERT_EQ(lock.try_lock_shared(), 0);
+  ASSERT_TRUE(lock.unlock_shared());
+
+  // A stop already requested fails fast, even on a free lock.
+  ASSERT_EQ(lock.lock(source.get_token()), ECANCELED);
+  ASSERT_EQ(lock.lock(std::stop_token()), 0);
+  ASSERT_TRUE(lock.unlock());
+}
+
+// The guards use the engine's stop_token overloads.
+TEST(FutexRWLockTest, TestGuardStopToken) {
+  rwlock::FutexRWLock lock;
+  rwlock::BasicSharedLock<rwlock::FutexRWLock> reader(lock);
+
+  std::jthread writer([&](std::stop_token stop) {
+    rwlock::BasicUniqueLock<rwlock::FutexRWLock> guard(lock, stop);
+    ASSERT_FALSE(guard.owns_lock());
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  writer.request_stop();
+  writer.join();
+
+  reader.unlock();
+  rwlock::BasicUniqueLock<rwlock::FutexRWLock> guard(lock, std::stop_token());
+  ASSERT_TRUE(guard.owns_lock());
+}
@@ -0,0 +1,152 @@
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "rwlock/futex_rw_lock.h"
+#include "rwlock/group_commit.h"
+#include "rwlock/rw_lock.h"
+#include "rwlock/shared_lock.h"
+
+namespace {
+
+struct Update {
+  int writer;
+  int seq;
+};
+
+} // namespace
+
+// Every record is applied once, under the exclusive lock, and each writer's
+// records in submission order.
+TEST(GroupCommitTest, TestMultipleWriters) {
+  rwlock::RWLock lock;
+  const int kThreads = 8;
+  const int kIters = 2000;
+  std::vector<int> last(kThreads, -1);
+  std::atomic<int> in_apply{0};
+  std::atomic<bool> out_of_order{false};
+  long applied = 0;
+
+  rwlock::GroupCommit<Update> commits(lock, [&](Update &u) {
+    EXPECT_EQ(in_apply.fetch_add(1), 0);
+    EXPECT_EQ(lock.try_lock_shared(), EBUSY);
+    if (u.seq != last[u.writer] + 1) {
+      out_of_order.store(true);
+    }
+    last[u.writer] = u.seq;
+    ++applied;
+    in_apply.fetch_sub(1);
+  });
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      std::vector<std::future<void>> pending;
+      for (int i = 0; i < kIters; ++i) {
+        pending.push_back(commits.submit(Update{t, i}));
+      }
+      for (auto &f : pending) {
+        f.get();
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  ASSERT_FALSE(out_of_order.load());
+  ASSERT_EQ(applied, static_cast<long>(kThreads) * kIters);
+}
+
+// Records queued while the leader waits for the lock go in its batch.
+TEST(GroupCommitTest, TestBatching) {
+  rwlock::RWLock lock;
+  std::vector<int> applied;
+  rwlock::GroupCommit<int> commits(lock,
+                                   [&](int &v) { applied.push_back(v); });
+
+  rwlock::SharedLock reader(lock);
+  std::atomic<bool> leader_done{false};
+  std::thread leader([&] {
+    commits.commit(0);
+    leader_done.store(true);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+  std::vector<std::future<void>> followers;
+  for (int i = 1; i <= 10; ++i) {
+    followers.push_back(commits.submit(i));
+  }
+  for (auto &f : followers) {
+    ASSERT_EQ(f.wait_for(std::chrono::seconds(0)),
+              std::future_status::timeout);
+  }
+  ASSERT_FALSE(leader_done.load());
+
+  reader.unlock();
+  leader.join();
+  for (auto &f : followers) {
+    ASSERT_EQ(f.wait_for(std::chrono::seconds(0)), std::future_status::ready);
+    f.get();
+  }
+  ASSERT_EQ(applied, (std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10}));
+}
+
+// A failing record reports through its own future only.
+TEST(GroupCommitTest, TestApplyThrows) {
+  rwlock::RWLock lock;
+  int sum = 0;
+  rwlock::GroupCommit<int> commits(lock, [&](int &v) {
+    if (v < 0) {
+      throw std::invalid_argument("negative");
+    }
+    sum += v;
+  });
+
+  commits.commit(1);
+  ASSERT_THROW(commits.commit(-1), std::invalid_argument);
+  commits.commit(2);
+  ASSERT_EQ(sum, 3);
+  ASSERT_EQ(lock.try_lock(), 0);
+  ASSERT_TRUE(lock.unlock());
+}
+
+// Works over other engines, with their guards for readers.
+TEST(GroupCommitTest, TestFutexRWLock) {
+  rwlock::FutexRWLock lock;
+  const int kThreads = 4;
+  const int kIters = 1000;
+  long applied = 0;
+  std::atomic<bool> torn{false};
+  rwlock::BasicGroupCommit<rwlock::FutexRWLock, int> commits(
+      lock, [&](int &v) {
+        EXPECT_EQ(lock.try_lock_shared(), EBUSY);
+        applied += v;
+        applied += v;
+      });
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < kIters; ++i) {
+        if ((i + t) % 2 == 0) {
+          commits.commit(1);
+        } else {
+          rwlock::BasicSharedLock<rwlock::FutexRWLock> guard(
+              *commits.rwlock());
+          if (applied % 2 != 0) {
+            torn.store(true);
+          }
+        }
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  ASSERT_FALSE(torn.load());
+  ASSERT_EQ(applied, 2L * kThreads * (kIters / 2));
+}
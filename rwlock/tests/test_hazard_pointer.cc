@@ -0,0 +1,120 @@
+#include <atomic>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+#include "rwlock/hazard_pointer.h"
+
+namespace {
+
+std::atomic<int> live_objects{0};
+
+struct Object : rwlock::HazardPointerObject<Object> {
+  explicit Object(int v) : value(v) { live_objects.fetch_add(1); }
+  ~Object() {
+    value = -1;
+    live_objects.fetch_sub(1);
+  }
+  int value;
+};
+
+} // namespace
+
+// A protected object survives scans until its protection is dropped.
+TEST(HazardPointerTest, TestProtectedObjectIsNotReclaimed) {
+  rwlock::HazardPointerDomain domain;
+  std::atomic<Object *> src{new Object(1)};
+
+  rwlock::HazardPointer hp = rwlock::make_hazard_pointer(domain);
+  Object *protected_object = hp.protect(src);
+  ASSERT_EQ(protected_object->value, 1);
+
+  src.store(new Object(2));
+  protected_object->retire(domain);
+  domain.reclaim();
+  EXPECT_EQ(domain.retired_count(), 1u);
+  EXPECT_EQ(protected_object->value, 1);
+
+  hp.reset_protection();
+  domain.reclaim();
+  EXPECT_EQ(domain.retired_count(), 0u);
+
+  src.load()->retire(domain);
+  domain.reclaim();
+  EXPECT_EQ(live_objects.load(), 0);
+}
+
+// Retiring past the threshold scans automatically.
+TEST(HazardPointerTest, TestThresholdTriggersScan) {
+  rwlock::HazardPointerDomain domain(16);
+  for (int i = 0; i < 100; ++i) {
+    (new Object(i))->retire(domain);
+    ASSERT_LT(domain.retired_count(), 16u);
+  }
+  domain.reclaim();
+  EXPECT_EQ(live_objects.load(), 0);
+}
+
+// The domain reclaims what is still retired when it is destroyed.
+TEST(HazardPointerTest, TestDomainDestructorReclaims) {
+  {
+    rwlock::HazardPointerDomain domain;
+    (new Object(1))->retire(domain);
+    (new Object(2))->retire(domain);
+    EXPECT_EQ(live_objects.load(), 2);
+  }
+  EXPECT_EQ(live_objects.load(), 0);
+}
+
+// Readers dereference objects a writer keeps replacing and retiring.
+TEST(HazardPointerTest, TestConcurrentReadersAndWriter) {
+  rwlock::HazardPointerDomain domain(8);
+  std::atomic<Object *> src{new Object(0)};
+  std::atomic<bool> keep_reading{true};
+  const int num_readers = 3;
+  const int updates = 20000;
+
+  auto reader_func = [&]() {
+    rwlock::HazardPointer hp(domain);
+    int last = 0;
+    while (keep_reading.load(std::memory_order_relaxed)) {
+      Object *object = hp.protect(src);
+      int value = object->value;
+      ASSERT_GE(value, last);
+      last = value;
+      hp.reset_protection();
+    }
+  };
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < num_readers; ++i) {
+    readers.emplace_back(reader_func);
+  }
+  for (int i = 1; i <= updates; ++i) {
+    Object *old = src.exchange(new Object(i));
+    old->retire(domain);
+  }
+  keep_reading.store(false);
+  for (auto &t : readers) {
+    t.join();
+  }
+
+  src.load()->retire(domain);
+  domain.reclaim();
+  EXPECT_EQ(live_objects.load(), 0);
+}
+
+TEST(HazardPointerTest, TestMoveSemantics) {
+  rwlock::HazardPointer empty;
+  EXPECT_TRUE(empty.empty());
+
+  rwlock::HazardPointer hp = rwlock::make_hazard_pointer();
+  EXPECT_FALSE(hp.empty());
+  rwlock::HazardPointer moved(std::move(hp));
+  EXPECT_TRUE(hp.empty());
+  EXPECT_FALSE(moved.empty());
+  empty = std::move(moved);
+  EXPECT_FALSE(empty.empty());
+  EXPECT_TRUE(moved.empty());
+}
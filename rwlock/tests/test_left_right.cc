@@ -0,0 +1,104 @@
+#include <atomic>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <map>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "rwlock/left_right.h"
+
+TEST(LeftRightTest, TestReadAndModify) {
+  rwlock::LeftRight<std::map<int, int>> map;
+
+  map.modify([](std::map<int, int> &m) { m[1] = 10; });
+  map.modify([](std::map<int, int> &m) { m[2] = 20; });
+
+  EXPECT_EQ(map.read([](const std::map<int, int> &m) { return m.size(); }),
+            2u);
+  EXPECT_EQ(map.read([](const std::map<int, int> &m) { return m.at(1); }), 10);
+  EXPECT_EQ(map.read([](const std::map<int, int> &m) { return m.at(2); }), 20);
+}
+
+// Readers never observe a half-applied mutation.
+TEST(LeftRightTest, TestReadersSeeWholeUpdates) {
+  rwlock::LeftRight<std::pair<long, long>> pair(0L, 0L);
+  std::atomic<bool> keep_reading{true};
+  const int num_readers = 3;
+  const int iterations = 2000;
+
+  auto reader_func = [&]() {
+    long last = 0;
+    while (keep_reading.load(std::memory_order_relaxed)) {
+      auto seen = pair.read([](const std::pair<long, long> &p) { return p; });
+      ASSERT_EQ(seen.first, seen.second);
+      ASSERT_GE(seen.first, last);
+      last = seen.first;
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_readers; ++i) {
+    threads.emplace_back(reader_func);
+  }
+  std::vector<std::thread> writers;
+  for (int i = 0; i < 2; ++i) {
+    writers.emplace_back([&]() {
+      for (int j = 0; j < iterations; ++j) {
+        pair.modify([](std::pair<long, long> &p) {
+          ++p.first;
+          ++p.second;
+        });
+      }
+    });
+  }
+  for (auto &t : writers) {
+    t.join();
+  }
+  keep_reading.store(false);
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  auto final_value =
+      pair.read([](const std::pair<long, long> &p) { return p; });
+  EXPECT_EQ(final_value.first, 2 * iterations);
+  EXPECT_EQ(final_value.second, 2 * iterations);
+}
+
+// A writer waiting for a slow reader to drain does not block new readers.
+TEST(LeftRightTest, TestReadersDoNotBlockBehindWriter) {
+  rwlock::LeftRight<int> value(1);
+  std::atomic<bool> in_read{false};
+  std::atomic<bool> release_reader{false};
+  std::atomic<bool> writer_done{false};
+
+  std::thread slow_reader([&]() {
+    value.read([&](const int &) {
+      in_read.store(true);
+      while (!release_reader.load()) {
+        std::this_thread::yield();
+      }
+      return 0;
+    });
+  });
+  while (!in_read.load()) {
+    std::this_thread::yield();
+  }
+
+  std::thread writer([&]() {
+    value.modify([](int &v) { v = 2; });
+    writer_done.store(true);
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_FALSE(writer_done.load());
+  // Readers proceed while the writer waits and see the new value.
+  EXPECT_EQ(value.read([](const int &v) { return v; }), 2);
+
+  release_reader.store(true);
+  slow_reader.join();
+  writer.join();
+  EXPECT_TRUE(writer_done.load());
+  EXPECT_EQ(value.read([](const int &v) { return v; }), 2);
+}
@@ -0,0 +1,125 @@
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+#include "rwlock/multi_lock.h"
+#include "rwlock/rw_lock.h"
+
+// Threads taking the same locks in opposite order do not deadlock.
+TEST(MultiLockTest, TestOppositeOrderDoesNotDeadlock) {
+  rwlock::RWLock a, b;
+  long balance_a = 0, balance_b = 0;
+  const int iterations = 2000;
+
+  std::thread forward([&]() {
+    for (int i = 0; i < iterations; ++i) {
+      rwlock::ScopedMultiLock guard(
+          {rwlock::exclusive(a), rwlock::exclusive(b)});
+      ++balance_a;
+      --balance_b;
+    }
+  });
+  std::thread backward([&]() {
+    for (int i = 0; i < iterations; ++i) {
+      rwlock::ScopedMultiLock guard(
+          {rwlock::exclusive(b), rwlock::exclusive(a)});
+      --balance_a;
+      ++balance_b;
+    }
+  });
+  forward.join();
+  backward.join();
+
+  EXPECT_EQ(balance_a, 0);
+  EXPECT_EQ(balance_b, 0);
+}
+
+// Each lock is held in its own mode and all are released together.
+TEST(MultiLockTest, TestMixedModes) {
+  rwlock::RWLock a, b;
+  {
+    rwlock::ScopedMultiLock guard({rwlock::shared(a), rwlock::exclusive(b)});
+    ASSERT_TRUE(guard.owns_locks());
+    // a is shared: other readers get in, writers do not.
+    ASSERT_EQ(a.try_lock_shared(), 0);
+    a.unlock();
+    EXPECT_EQ(a.try_lock(), EBUSY);
+    // b is exclusive.
+    EXPECT_EQ(b.try_lock_shared(), EBUSY);
+  }
+  EXPECT_EQ(a.try_lock(), 0);
+  EXPECT_EQ(b.try_lock(), 0);
+  a.unlock();
+  b.unlock();
+}
+
+// A lock requested twice is taken once, in the stronger mode.
+TEST(MultiLockTest, TestDuplicateRequestsMerge) {
+  rwlock::RWLock a;
+  std::vector<rwlock::LockRequest> requests = {rwlock::shared(a),
+                                               rwlock::exclusive(a)};
+  ASSERT_EQ(rwlock::lock_all(requests), 0);
+  ASSERT_EQ(requests.size(), 1u);
+  EXPECT_EQ(requests[0].mode, rwlock::LockMode::kExclusive);
+  EXPECT_EQ(a.try_lock_shared(), EBUSY);
+  rwlock::unlock_all(requests);
+  EXPECT_EQ(a.try_lock(), 0);
+  a.unlock();
+}
+
+// try_lock_all backs off completely if any lock is unavailable.
+TEST(MultiLockTest, TestTryLockAllBacksOff) {
+  rwlock::RWLock a, b, c;
+  ASSERT_EQ(b.lock(), 0);
+
+  std::vector<rwlock::LockRequest> requests = {
+      rwlock::exclusive(a), rwlock::shared(b), rwlock::exclusive(c)};
+  EXPECT_EQ(rwlock::try_lock_all(requests), EBUSY);
+  EXPECT_EQ(a.try_lock(), 0);
+  EXPECT_EQ(c.try_lock(), 0);
+  a.unlock();
+  c.unlock();
+  b.unlock();
+
+  EXPECT_EQ(rwlock::try_lock_all(requests), 0);
+  rwlock::unlock_all(requests);
+}
+
+// Transactions over overlapping shards run concurrently and stay consistent.
+TEST(MultiLockTest, TestConcurrentTransfers) {
+  const int num_shards = 4;
+  rwlock::RWLock locks[num_shards];
+  long balances[num_shards] = {};
+  const int num_threads = 4;
+  const int iterations = 1000;
+
+  auto transfer_func = [&](int idx) {
+    for (int i = 0; i < iterations; ++i) {
+      int from = (idx + i) % num_shards;
+      int to = (idx + 2 * i + 1) % num_shards;
+      int audit = (idx + 3 * i + 2) % num_shards;
+      rwlock::ScopedMultiLock guard({rwlock::exclusive(locks[from]),
+                                     rwlock::exclusive(locks[to]),
+                                     rwlock::shared(locks[audit])});
+      --balances[from];
+      ++balances[to];
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.emplace_back(transfer_func, i);
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  long total = 0;
+  for (long balance : balances) {
+    total += balance;
+  }
+  EXPECT_EQ(total, 0);
+}
@@ -0,0 +1,145 @@
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+#include "rwlock/percpu_rw_lock.h"
+#include "rwlock/rseq.h"
+#include "rwlock/shared_lock.h"
+#include "rwlock/tests/counter_test.h"
+#include "rwlock/unique_lock.h"
+
+#include <sched.h>
+
+// percpu_add lands on some CPU's counter, from any thread.
+TEST(PerCpuRWLockTest, TestPerCpuAdd) {
+  struct alignas(64) Slot {
+    std::atomic<std::int64_t> value{0};
+  };
+  const std::size_t cpus = 512;
+  std::vector<Slot> slots(cpus);
+  const int kThreads = 4;
+  const int kIters = 10000;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < kIters; ++i) {
+        rwlock::detail::percpu_add(&slots[0].value, sizeof(Slot), cpus, 2);
+        rwlock::detail::percpu_add(&slots[0].value, sizeof(Slot), cpus, -1);
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  std::int64_t sum = 0;
+  for (const Slot &s : slots) {
+    sum += s.value.load();
+  }
+  ASSERT_EQ(sum, static_cast<std::int64_t>(kThreads) * kIters);
+#if RWLOCK_HAVE_RSEQ
+  if (rwlock::detail::rseq_available()) {
+    // Single-threaded, the add goes to the CPU we run on.
+    std::vector<Slot> mine(cpus);
+    rwlock::detail::percpu_add(&mine[0].value, sizeof(Slot), cpus, 1);
+    std::int64_t total = 0;
+    for (const Slot &s : mine) {
+      total += s.value.load();
+    }
+    ASSERT_EQ(total, 1);
+  }
+#endif
+}
+
+// A CPU numbered past the counters adds to counter cpu % cpus instead of
+// writing past the end of the array. Visits every CPU we may run on.
+TEST(PerCpuRWLockTest, TestPerCpuAddOutOfRange) {
+  struct alignas(64) Slot {
+    std::atomic<std::int64_t> value{0};
+  };
+  // Only the first slot is handed out as a counter; the second catches
+  // stray writes.
+  std::vector<Slot> slots(2);
+  cpu_set_t allowed;
+  ASSERT_EQ(sched_getaffinity(0, sizeof(allowed), &allowed), 0);
+  int visited = 0;
+  std::thread worker([&] {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (!CPU_ISSET(cpu, &allowed)) {
+        continue;
+      }
+      cpu_set_t one;
+      CPU_ZERO(&one);
+      CPU_SET(cpu, &one);
+      if (sched_setaffinity(0, sizeof(one), &one) != 0) {
+        continue;
+      }
+      rwlock::detail::percpu_add(&slots[0].value, sizeof(Slot), 1, 1);
+      ++visited;
+    }
+  });
+  worker.join();
+  ASSERT_GT(visited, 0);
+  ASSERT_EQ(slots[0].value.load(), visited);
+  ASSERT_EQ(slots[1].value.load(), 0);
+}
+
+// Any reader left on a CPU counter holds off try_lock; the writer relocking
+// gets EDEADLK.
+TEST(PerCpuRWLockTest, TestTryLock) {
+  rwlock::PerCpuRWLock lock;
+
+  ASSERT_EQ(lock.try_lock(), 0);
+  ASSERT_EQ(lock.try_lock(), EDEADLK);
+  ASSERT_EQ(lock.lock(), EDEADLK);
+  ASSERT_EQ(lock.try_lock_shared(), EBUSY);
+  ASSERT_TRUE(lock.unlock());
+
+  ASSERT_EQ(lock.try_lock_shared(), 0);
+  ASSERT_EQ(lock.lock_shared(), 0);
+  ASSERT_EQ(lock.try_lock(), EBUSY);
+  ASSERT_TRUE(lock.unlock_shared());
+  ASSERT_EQ(lock.try_lock(), EBUSY);
+  ASSERT_TRUE(lock.unlock());
+  ASSERT_EQ(lock.try_lock(), 0);
+  ASSERT_TRUE(lock.unlock());
+}
+
+// A writer waits for a reader that migrates between lock and unlock.
+TEST(PerCpuRWLockTest, TestWriterWaitsForReader) {
+  rwlock::PerCpuRWLock lock;
+  std::atomic<bool> reader_in{false};
+  std::atomic<bool> release{false};
+  std::thread reader([&] {
+    rwlock::BasicSharedLock<rwlock::PerCpuRWLock> guard(lock);
+    reader_in.store(true);
+    while (!release.load()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  });
+  while (!reader_in.load()) {
+    std::this_thread::yield();
+  }
+
+  std::atomic<bool> writer_in{false};
+  std::thread writer([&] {
+    rwlock::BasicUniqueLock<rwlock::PerCpuRWLock> guard(lock);
+    writer_in.store(true);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ASSERT_FALSE(writer_in.load());
+  ASSERT_EQ(lock.try_lock_shared(), EBUSY);
+  release.store(true);
+  reader.join();
+  writer.join();
+  ASSERT_TRUE(writer_in.load());
+}
+
+TEST(PerCpuRWLockTest, TestContention) {
+  rwlock::PerCpuRWLock lock;
+  run_counter_test<rwlock::PerCpuRWLock, 8, 3200, 16>(lock);
+}
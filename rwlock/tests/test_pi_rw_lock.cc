@@ -0,0 +1,150 @@
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "rwlock/pi_rw_lock.h"
+#include "rwlock/shared_lock.h"
+#include "rwlock/tests/counter_test.h"
+#include "rwlock/unique_lock.h"
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+// Effective kernel priority of a thread (field 18 of its stat); negative
+// once it runs at a real-time priority.
+int kernel_prio(pid_t tid) {
+  std::ifstream in("/proc/self/task/" + std::to_string(tid) + "/stat");
+  std::string stat((std::istreambuf_iterator<char>(in)),
+                   std::istreambuf_iterator<char>());
+  // Fields after the parenthesised command name start at field 3.
+  std::istringstream rest(stat.substr(stat.rfind(')') + 2));
+  std::string field;
+  for (int i = 3; i <= 18; ++i) {
+    rest >> field;
+  }
+  return std::stoi(field);
+}
+
+} // namespace
+
+// The writer is tracked by thread id: taking the lock again reports
+// EDEADLK.
+TEST(PIRWLockTest, TestTryLock) {
+  rwlock::PIRWLock lock;
+
+  ASSERT_EQ(lock.try_lock(), 0);
+  ASSERT_EQ(lock.try_lock(), EDEADLK);
+  ASSERT_EQ(lock.lock(), EDEADLK);
+  ASSERT_EQ(lock.try_lock_shared(), EBUSY);
+  ASSERT_TRUE(lock.unlock());
+
+  ASSERT_EQ(lock.try_lock_shared(), 0);
+  ASSERT_EQ(lock.lock_shared(), 0);
+  ASSERT_EQ(lock.try_lock(), EBUSY);
+  ASSERT_TRUE(lock.unlock_shared());
+  ASSERT_TRUE(lock.unlock());
+  ASSERT_FALSE(lock.unlock());
+  ASSERT_EQ(lock.try_lock(), 0);
+  ASSERT_TRUE(lock.unlock());
+}
+
+// A writer waits for readers already inside; readers arriving meanwhile
+// queue behind it.
+TEST(PIRWLockTest, TestWriterDrainsReaders) {
+  rwlock::PIRWLock lock;
+  ASSERT_EQ(lock.lock_shared(), 0);
+
+  std::atomic<bool> writer_in{false};
+  std::thread writer([&] {
+    rwlock::BasicUniqueLock<rwlock::PIRWLock> guard(lock);
+    writer_in.store(true);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    writer_in.store(false);
+  });
+  while (lock.try_lock_shared() == 0) {
+    lock.unlock_shared();
+    std::this_thread::yield();
+  }
+  ASSERT_FALSE(writer_in.load());
+
+  std::atomic<bool> overlap{false};
+  std::thread reader([&] {
+    rwlock::BasicSharedLock<rwlock::PIRWLock> guard(lock);
+    if (writer_in.load()) {
+      overlap.store(true);
+    }
+  });
+  ASSERT_TRUE(lock.unlock_shared());
+  writer.join();
+  reader.join();
+  ASSERT_FALSE(overlap.load());
+}
+
+TEST(PIRWLockTest, TestContention) {
+  rwlock::PIRWLock lock;
+  run_counter_test<rwlock::PIRWLock, 4, 2000>(lock);
+}
+
+// A SCHED_FIFO thread blocked on the lock boosts the normal-priority writer
+// holding it.
+TEST(PIRWLockTest, TestPriorityInheritance) {
+  rwlock::PIRWLock lock;
+  std::atomic<pid_t> holder_tid{0};
+  std::atomic<bool> release{false};
+
+  std::thread holder([&] {
+    rwlock::BasicUniqueLock<rwlock::PIRWLock> guard(lock);
+    holder_tid.store(static_cast<pid_t>(syscall(SYS_gettid)));
+    holder_tid.notify_all();
+    release.wait(false); // Sleeps, so a boosted holder does not hog the CPU.
+  });
+  holder_tid.wait(0);
+  const int normal_prio = kernel_prio(holder_tid.load());
+  ASSERT_GE(normal_prio, 0);
+
+  std::thread rt_waiter;
+  std::atomic<int> sched_rc{-1};
+  std::atomic<bool> sched_done{false};
+  rt_waiter = std::thread([&] {
+    sched_param param{};
+    param.sched_priority = 10;
+    const int rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    sched_rc.store(rc);
+    sched_done.store(true);
+    if (rc == 0) {
+      rwlock::BasicUniqueLock<rwlock::PIRWLock> guard(lock);
+    }
+  });
+  while (!sched_done.load()) {
+    std::this_thread::yield();
+  }
+
+  bool boosted = false;
+  if (sched_rc.load() == 0) {
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!boosted && std::chrono::steady_clock::now() < deadline) {
+      boosted = kernel_prio(holder_tid.load()) < 0;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+  release.store(true);
+  release.notify_all();
+  holder.join();
+  rt_waiter.join();
+
+  if (sched_rc.load() != 0) {
+    GTEST_SKIP() << "no permission for SCHED_FIFO";
+  }
+  ASSERT_TRUE(boosted);
+  ASSERT_GE(kernel_prio(static_cast<pid_t>(syscall(SYS_gettid))), 0);
+}
@@ -0,0 +1,160 @@
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "rwlock/qos_rw_lock.h"
+#include "rwlock/shared_lock.h"
+#include "rwlock/tests/counter_test.h"
+#include "rwlock/unique_lock.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Starts a writer of class qos that appends id to order once it gets the
+// lock, and gives it time to queue.
+std::thread queue_writer(rwlock::QosRWLock &lock, rwlock::QosClass qos,
+                         int id, std::mutex &m, std::vector<int> &order) {
+  std::thread t([&lock, qos, id, &m, &order] {
+    rwlock::BasicUniqueLock<rwlock::QosRWLock> guard(lock, qos);
+    std::lock_guard<std::mutex> g(m);
+    order.push_back(id);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  return t;
+}
+
+} // namespace
+
+// Requests that need not wait are granted at once, whatever their class.
+TEST(QosRWLockTest, TestTryLock) {
+  rwlock::QosRWLock lock;
+
+  ASSERT_EQ(lock.try_lock(), 0);
+  ASSERT_EQ(lock.try_lock(), EBUSY);
+  ASSERT_EQ(lock.try_lock_shared(), EBUSY);
+  ASSERT_TRUE(lock.unlock());
+  ASSERT_FALSE(lock.unlock());
+
+  ASSERT_EQ(lock.try_lock_shared(), 0);
+  ASSERT_EQ(lock.lock_shared(rwlock::QosClass::kBatch), 0);
+  ASSERT_EQ(lock.try_lock(), EBUSY);
+  ASSERT_TRUE(lock.unlock_shared());
+  ASSERT_TRUE(lock.unlock());
+  ASSERT_FALSE(lock.unlock_shared());
+  ASSERT_EQ(lock.lock(rwlock::QosClass::kInteractive), 0);
+  ASSERT_TRUE(lock.unlock());
+}
+
+// The guards pass their class on and keep it across moves.
+TEST(QosRWLockTest, TestGuardClass) {
+  rwlock::QosRWLock lock;
+  {
+    rwlock::BasicUniqueLock<rwlock::QosRWLock> guard(
+        lock, rwlock::QosClass::kInteractive);
+    ASSERT_TRUE(guard.owns_lock());
+    ASSERT_EQ(guard.qos(), rwlock::QosClass::kInteractive);
+    rwlock::BasicUniqueLock<rwlock::QosRWLock> moved(std::move(guard));
+    ASSERT_EQ(moved.qos(), rwlock::QosClass::kInteractive);
+    ASSERT_EQ(lock.try_lock_shared(), EBUSY);
+  }
+  rwlock::BasicSharedLock<rwlock::QosRWLock> guard(lock,
+                                                    rwlock::QosClass::kBatch);
+  ASSERT_EQ(guard.qos(), rwlock::QosClass::kBatch);
+  guard.unlock();
+  guard.lock();
+  ASSERT_TRUE(guard.owns_lock());
+  ASSERT_EQ(lock.try_lock(), EBUSY);
+
+  // Guards over engines without classes do not take one.
+  static_assert(!std::is_constructible_v<rwlock::UniqueLock, rwlock::RWLock &,
+                                         rwlock::QosClass>);
+  static_assert(!std::is_constructible_v<rwlock::SharedLock, rwlock::RWLock &,
+                                         rwlock::QosClass>);
+}
+
+// With a long aging step, queued requests are served by class, then in
+// arrival order within a class.
+TEST(QosRWLockTest, TestClassOrder) {
+  rwlock::QosRWLock lock(std::chrono::seconds(10));
+  std::mutex m;
+  std::vector<int> order;
+  ASSERT_EQ(lock.lock(), 0);
+
+  std::vector<std::thread> threads;
+  threads.push_back(queue_writer(lock, rwlock::QosClass::kBatch, 1, m, order));
+  threads.push_back(
+      queue_writer(lock, rwlock::QosClass::kNormal, 2, m, order));
+  threads.push_back(
+      queue_writer(lock, rwlock::QosClass::kInteractive, 3, m, order));
+  threads.push_back(
+      queue_writer(lock, rwlock::QosClass::kInteractive, 4, m, order));
+  ASSERT_TRUE(lock.unlock());
+  for (auto &t : threads) {
+    t.join();
+  }
+  ASSERT_EQ(order, (std::vector<int>{3, 4, 2, 1}));
+}
+
+// A batch request that has waited long enough outranks a new interactive
+// one.
+TEST(QosRWLockTest, TestAging) {
+  rwlock::QosRWLock lock(std::chrono::milliseconds(1));
+  std::mutex m;
+  std::vector<int> order;
+  ASSERT_EQ(lock.lock(), 0);
+
+  std::thread batch = queue_writer(lock, rwlock::QosClass::kBatch, 1, m, order);
+  std::thread interactive =
+      queue_writer(lock, rwlock::QosClass::kInteractive, 2, m, order);
+  ASSERT_TRUE(lock.unlock());
+  batch.join();
+  interactive.join();
+  ASSERT_EQ(order, (std::vector<int>{1, 2}));
+}
+
+// More urgent readers overtake a queued batch writer until it has aged past
+// them.
+TEST(QosRWLockTest, TestReadersAndQueuedWriter) {
+  rwlock::QosRWLock lock(std::chrono::milliseconds(50));
+  ASSERT_EQ(lock.lock_shared(), 0);
+
+  std::atomic<bool> writer_in{false};
+  std::thread writer([&] {
+    rwlock::BasicUniqueLock<rwlock::QosRWLock> guard(
+        lock, rwlock::QosClass::kBatch);
+    writer_in.store(true);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  ASSERT_FALSE(writer_in.load());
+
+  // Ranked ahead of the writer: joins the readers inside.
+  ASSERT_EQ(lock.try_lock_shared(), 0);
+  ASSERT_TRUE(lock.unlock_shared());
+
+  // Once the writer has waited an aging step, new kNormal readers queue.
+  const auto deadline = Clock::now() + std::chrono::seconds(5);
+  while (lock.try_lock_shared() == 0 && Clock::now() < deadline) {
+    ASSERT_TRUE(lock.unlock_shared());
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  ASSERT_EQ(lock.try_lock_shared(), EBUSY);
+  ASSERT_FALSE(writer_in.load());
+  ASSERT_TRUE(lock.unlock_shared());
+  writer.join();
+  ASSERT_TRUE(writer_in.load());
+}
+
+// Each thread waits in its own class.
+TEST(QosRWLockTest, TestContention) {
+  rwlock::QosRWLock lock(std::chrono::microseconds(100));
+  run_counter_test<rwlock::QosRWLock, 6, 2000, 2>(lock, [](int t) {
+    return std::tuple(static_cast<rwlock::QosClass>(t % 3));
+  });
+}
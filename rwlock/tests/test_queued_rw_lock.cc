@@ -0,0 +1,99 @@
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "rwlock/queued_rw_lock.h"
+#include "rwlock/shared_lock.h"
+#include "rwlock/tests/counter_test.h"
+#include "rwlock/unique_lock.h"
+#include "rwlock/wait_strategy.h"
+
+namespace {
+
+// Spinning threads share one CPU in CI; yield instead of pausing.
+using YieldingLock = rwlock::BasicQueuedRWLock<rwlock::YieldWait>;
+
+} // namespace
+
+// Unlock calls fail once nothing is held; nothing tracks the writer, so a
+// second try_lock is just EBUSY.
+TEST(QueuedRWLockTest, TestTryLock) {
+  rwlock::QueuedRWLock lock;
+
+  ASSERT_EQ(lock.try_lock(), 0);
+  ASSERT_EQ(lock.try_lock(), EBUSY);
+  ASSERT_EQ(lock.try_lock_shared(), EBUSY);
+  ASSERT_TRUE(lock.unlock());
+  ASSERT_FALSE(lock.unlock());
+
+  ASSERT_EQ(lock.try_lock_shared(), 0);
+  ASSERT_EQ(lock.lock_shared(), 0);
+  ASSERT_EQ(lock.try_lock(), EBUSY);
+  ASSERT_TRUE(lock.unlock_shared());
+  ASSERT_TRUE(lock.unlock());
+  ASSERT_FALSE(lock.unlock_shared());
+  ASSERT_EQ(lock.lock(), 0);
+  ASSERT_TRUE(lock.unlock());
+}
+
+// Queued lockers are served in arrival order, whatever their mode.
+TEST(QueuedRWLockTest, TestFifoOrder) {
+  YieldingLock lock;
+  std::mutex m;
+  std::vector<int> order;
+  ASSERT_EQ(lock.lock(), 0);
+
+  std::vector<std::thread> threads;
+  auto queue = [&](int id, bool exclusive) {
+    threads.emplace_back([&, id, exclusive] {
+      if (exclusive) {
+        rwlock::BasicUniqueLock<YieldingLock> guard(lock);
+        std::lock_guard<std::mutex> g(m);
+        order.push_back(id);
+      } else {
+        rwlock::BasicSharedLock<YieldingLock> guard(lock);
+        std::lock_guard<std::mutex> g(m);
+        order.push_back(id);
+      }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  };
+  queue(1, /*exclusive=*/true);
+  queue(2, /*exclusive=*/false);
+  queue(3, /*exclusive=*/true);
+  queue(4, /*exclusive=*/false);
+  ASSERT_TRUE(lock.unlock());
+  for (auto &t : threads) {
+    t.join();
+  }
+  ASSERT_EQ(order, (std::vector<int>{1, 2, 3, 4}));
+}
+
+// A writer waiting at the head of the queue holds off new readers.
+TEST(QueuedRWLockTest, TestWriterHoldsOffReaders) {
+  YieldingLock lock;
+  ASSERT_EQ(lock.lock_shared(), 0);
+
+  std::atomic<bool> writer_in{false};
+  std::thread writer([&] {
+    rwlock::BasicUniqueLock<YieldingLock> guard(lock);
+    writer_in.store(true);
+  });
+  while (lock.try_lock_shared() == 0) {
+    lock.unlock_shared();
+    std::this_thread::yield();
+  }
+  ASSERT_FALSE(writer_in.load());
+  ASSERT_TRUE(lock.unlock_shared());
+  writer.join();
+  ASSERT_TRUE(writer_in.load());
+}
+
+TEST(QueuedRWLockTest, TestContention) {
+  YieldingLock lock;
+  run_counter_test<YieldingLock, 8, 4000>(lock);
+}
@@ -0,0 +1,92 @@
+#include <atomic>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rwlock/sharded_lru_cache.h"
+
+TEST(ShardedLRUCacheTest, TestInsertFindErase) {
+  rwlock::ShardedLRUCache<std::string, int> cache(16, 4);
+  EXPECT_EQ(cache.capacity(), 16u);
+
+  EXPECT_TRUE(cache.insert_or_assign("a", 1));
+  EXPECT_FALSE(cache.insert_or_assign("a", 2));
+  EXPECT_EQ(cache.find("a"), 2);
+  EXPECT_FALSE(cache.find("b").has_value());
+  EXPECT_EQ(cache.size(), 1u);
+
+  EXPECT_TRUE(cache.erase("a"));
+  EXPECT_FALSE(cache.erase("a"));
+  EXPECT_EQ(cache.size(), 0u);
+}
+
+// Entries hit since the CLOCK hand last passed survive eviction.
+TEST(ShardedLRUCacheTest, TestEvictsUnreferencedFirst) {
+  rwlock::ShardedLRUCache<int, int> cache(4, 1);
+  for (int i = 0; i < 4; ++i) {
+    cache.insert_or_assign(i, i);
+  }
+  EXPECT_EQ(cache.find(0), 0);
+  EXPECT_EQ(cache.find(2), 2);
+
+  cache.insert_or_assign(4, 4);
+  EXPECT_EQ(cache.size(), 4u);
+  EXPECT_TRUE(cache.find(0).has_value());
+  EXPECT_TRUE(cache.find(2).has_value());
+  EXPECT_TRUE(cache.find(4).has_value());
+  EXPECT_FALSE(cache.find(1).has_value());
+
+  cache.insert_or_assign(5, 5);
+  EXPECT_FALSE(cache.find(3).has_value());
+  EXPECT_EQ(cache.size(), 4u);
+}
+
+// Size never exceeds capacity and erased slots are reused.
+TEST(ShardedLRUCacheTest, TestBoundedSize) {
+  rwlock::ShardedLRUCache<int, int> cache(64, 4);
+  for (int i = 0; i < 1000; ++i) {
+    cache.insert_or_assign(i, i);
+    ASSERT_LE(cache.size(), cache.capacity());
+  }
+  for (int i = 0; i < 1000; ++i) {
+    cache.erase(i);
+  }
+  EXPECT_EQ(cache.size(), 0u);
+  for (int i = 0; i < 16; ++i) {
+    cache.insert_or_assign(i, i);
+  }
+  EXPECT_EQ(cache.size(), 16u);
+}
+
+// Concurrent hits and inserts return only values that were stored.
+TEST(ShardedLRUCacheTest, TestConcurrentAccess) {
+  rwlock::ShardedLRUCache<int, int> cache(256, 8);
+  const int num_threads = 4;
+  const int iterations = 5000;
+  std::atomic<int> hits{0};
+
+  auto worker = [&](int idx) {
+    for (int i = 0; i < iterations; ++i) {
+      int key = (i * 7 + idx) % 128;
+      std::optional<int> value = cache.find(key);
+      if (value) {
+        ASSERT_EQ(*value, key * 3);
+        hits.fetch_add(1, std::memory_order_relaxed);
+      } else {
+        cache.insert_or_assign(key, key * 3);
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.emplace_back(worker, i);
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  EXPECT_GT(hits.load(), 0);
+  EXPECT_LE(cache.size(), cache.capacity());
+}
@@ -123,3 +123,14 @@ TEST(SharedLockTest, TestExclusiveLockBlocksReaders) {
   }
   EXPECT_TRUE(writer_blocked);
 }
+
+// try_lock() takes a shared lock, so it succeeds alongside other readers.
+TEST(SharedLockTest, TestTryLockIsShared) {
+  rwlock::RWLock lock;
+  rwlock::SharedLock first(lock);
+  rwlock::SharedLock second(lock);
+  second.unlock();
+  ASSERT_FALSE(second.owns_lock());
+  ASSERT_TRUE(second.try_lock());
+  ASSERT_TRUE(second.owns_lock());
+}
@@ -0,0 +1,104 @@
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+#include "rwlock/shared_lock.h"
+#include "rwlock/snzi_rw_lock.h"
+#include "rwlock/tests/counter_test.h"
+#include "rwlock/unique_lock.h"
+
+// The writer is tracked by thread: taking the lock again reports EDEADLK,
+// and unlock() releases a read lock when no writer holds it.
+TEST(SnziRWLockTest, TestTryLock) {
+  rwlock::SnziRWLock lock(4);
+
+  ASSERT_EQ(lock.try_lock(), 0);
+  ASSERT_EQ(lock.try_lock(), EDEADLK);
+  ASSERT_EQ(lock.lock(), EDEADLK);
+  ASSERT_EQ(lock.try_lock_shared(), EBUSY);
+  ASSERT_TRUE(lock.unlock());
+  ASSERT_FALSE(lock.unlock());
+
+  ASSERT_EQ(lock.try_lock_shared(), 0);
+  ASSERT_EQ(lock.lock_shared(), 0);
+  ASSERT_EQ(lock.try_lock(), EBUSY);
+  ASSERT_TRUE(lock.unlock_shared());
+  ASSERT_TRUE(lock.unlock());
+  ASSERT_FALSE(lock.unlock_shared());
+  ASSERT_EQ(lock.try_lock(), 0);
+  ASSERT_TRUE(lock.unlock());
+}
+
+// Readers on different leaves are all seen by the writer.
+TEST(SnziRWLockTest, TestReadersOnManyLeaves) {
+  rwlock::SnziRWLock lock(8);
+  const int kReaders = 32;
+  std::atomic<int> inside{0};
+  std::atomic<bool> release{false};
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < kReaders; ++i) {
+    readers.emplace_back([&] {
+      rwlock::BasicSharedLock<rwlock::SnziRWLock> guard(lock);
+      inside.fetch_add(1);
+      while (!release.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    });
+  }
+  while (inside.load() != kReaders) {
+    std::this_thread::yield();
+  }
+  ASSERT_EQ(lock.try_lock(), EBUSY);
+
+  std::atomic<bool> writer_in{false};
+  std::thread writer([&] {
+    rwlock::BasicUniqueLock<rwlock::SnziRWLock> guard(lock);
+    writer_in.store(true);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ASSERT_FALSE(writer_in.load());
+  // The waiting writer holds off new readers.
+  ASSERT_EQ(lock.try_lock_shared(), EBUSY);
+
+  release.store(true);
+  for (auto &t : readers) {
+    t.join();
+  }
+  writer.join();
+  ASSERT_TRUE(writer_in.load());
+  ASSERT_EQ(lock.try_lock(), 0);
+  ASSERT_TRUE(lock.unlock());
+}
+
+// More threads than leaves, so readers share leaves.
+TEST(SnziRWLockTest, TestContention) {
+  rwlock::SnziRWLock lock(3);
+  run_counter_test<rwlock::SnziRWLock, 8, 3000, 8>(lock);
+}
+
+// A writer with a non-parking wait strategy still waits out the readers.
+TEST(SnziRWLockTest, TestYieldingWriter) {
+  using YieldingLock = rwlock::BasicSnziRWLock<rwlock::YieldWait>;
+  YieldingLock lock(4);
+  std::atomic<bool> release{false};
+  std::atomic<bool> writer_in{false};
+
+  ASSERT_EQ(lock.lock_shared(), 0);
+  std::thread writer([&] {
+    rwlock::BasicUniqueLock<YieldingLock> guard(lock);
+    EXPECT_TRUE(release.load());
+    writer_in.store(true);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ASSERT_FALSE(writer_in.load());
+  release.store(true);
+  ASSERT_TRUE(lock.unlock_shared());
+  writer.join();
+  ASSERT_TRUE(writer_in.load());
+  ASSERT_EQ(lock.try_lock_shared(), 0);
+  ASSERT_TRUE(lock.unlock_shared());
+}
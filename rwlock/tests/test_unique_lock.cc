@@ -3,10 +3,12 @@
 #include <cstdlib>
 #include <gtest/gtest.h>
 #include <iostream>
+#include <stop_token>
 #include <thread>
 #include <vector>
 
 #include "rwlock/rw_lock.h"
+#include "rwlock/shared_lock.h"
 #include "rwlock/unique_lock.h"
 
 TEST(UniqueLockTest, TestMultipleWriters) {
@@ -35,3 +37,24 @@ TEST(UniqueLockTest, TestMultipleWriters) {
   }
   EXPECT_EQ(max_writers.load(), 1);
 }
+
+// With RWLock, a stop_token acquisition polls and gives up on request.
+TEST(UniqueLockTest, TestStopToken) {
+  rwlock::RWLock lock;
+  rwlock::SharedLock reader(lock);
+
+  std::stop_source source;
+  std::thread writer([&] {
+    rwlock::UniqueLock guard(lock, source.get_token());
+    ASSERT_FALSE(guard.owns_lock());
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  source.request_stop();
+  writer.join();
+
+  reader.unlock();
+  rwlock::UniqueLock guard(lock, source.get_token());
+  ASSERT_FALSE(guard.owns_lock());
+  ASSERT_TRUE(guard.lock(std::stop_token()));
+  ASSERT_TRUE(guard.owns_lock());
+}
@@ -0,0 +1,190 @@
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <thread>
+
+#include "rwlock/futex_rw_lock.h"
+#include "rwlock/multi_lock.h"
+#include "rwlock/unique_lock.h"
+#include "rwlock/uring_lock.h"
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+// Just enough of a raw io_uring to submit SQEs and wait for completions.
+class TestRing {
+public:
+  TestRing() {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    fd_ = static_cast<int>(syscall(SYS_io_uring_setup, 8, &params));
+    if (fd_ < 0) {
+      return;
+    }
+    sq_size_ = params.sq_off.array + params.sq_entries * sizeof(std::uint32_t);
+    cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    sq_ = static_cast<char *>(mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE,
+                                   MAP_SHARED | MAP_POPULATE, fd_,
+                                   IORING_OFF_SQ_RING));
+    cq_ = static_cast<char *>(mmap(nullptr, cq_size_, PROT_READ | PROT_WRITE,
+                                   MAP_SHARED | MAP_POPULATE, fd_,
+                                   IORING_OFF_CQ_RING));
+    sqes_ = static_cast<io_uring_sqe *>(
+        mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe),
+             PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+             IORING_OFF_SQES));
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    params_ = params;
+  }
+
+  ~TestRing() {
+    if (fd_ >= 0) {
+      munmap(sqes_, sqes_size_);
+      munmap(cq_, cq_size_);
+      munmap(sq_, sq_size_);
+      close(fd_);
+    }
+  }
+
+  bool ok() const { return fd_ >= 0; }
+
+  // Hands out the next SQE; submit() sends everything handed out.
+  io_uring_sqe *get_sqe() {
+    const std::uint32_t mask = *u32(sq_, params_.sq_off.ring_mask);
+    const std::uint32_t index = pending_tail_ & mask;
+    u32(sq_, params_.sq_off.array)[index] = index;
+    ++pending_tail_;
+    return &sqes_[index];
+  }
+
+  int submit() {
+    std::atomic_ref<std::uint32_t>(*u32(sq_, params_.sq_off.tail))
+        .store(pending_tail_, std::memory_order_release);
+    const std::uint32_t count = pending_tail_ - submitted_;
+    submitted_ = pending_tail_;
+    return static_cast<int>(
+        syscall(SYS_io_uring_enter, fd_, count, 0, 0, nullptr, 0));
+  }
+
+  // Blocks for the next completion.
+  io_uring_cqe wait_cqe() {
+    std::atomic_ref<std::uint32_t> tail(*u32(cq_, params_.cq_off.tail));
+    std::uint32_t *head = u32(cq_, params_.cq_off.head);
+    while (tail.load(std::memory_order_acquire) == *head) {
+      syscall(SYS_io_uring_enter, fd_, 0, 1, IORING_ENTER_GETEVENTS, nullptr,
+              0);
+    }
+    const std::uint32_t mask = *u32(cq_, params_.cq_off.ring_mask);
+    const io_uring_cqe cqe = reinterpret_cast<io_uring_cqe *>(
+        cq_ + params_.cq_off.cqes)[*head & mask];
+    std::atomic_ref<std::uint32_t>(*head).store(*head + 1,
+                                                std::memory_order_release);
+    return cqe;
+  }
+
+private:
+  static std::uint32_t *u32(char *base, std::uint32_t offset) {
+    return reinterpret_cast<std::uint32_t *>(base + offset);
+  }
+
+  int fd_ = -1;
+  io_uring_params params_;
+  char *sq_ = nullptr;
+  char *cq_ = nullptr;
+  io_uring_sqe *sqes_ = nullptr;
+  std::size_t sq_size_ = 0;
+  std::size_t cq_size_ = 0;
+  std::size_t sqes_size_ = 0;
+  std::uint32_t pending_tail_ = 0;
+  std::uint32_t submitted_ = 0;
+};
+
+} // namespace
+
+// The prepared SQE encodes a futex2 wait on the lock word.
+TEST(UringLockTest, TestPreparedWait) {
+  rwlock::FutexRWLock lock;
+  ASSERT_EQ(lock.lock(), 0);
+
+  io_uring_sqe sqe;
+  int calls = 0;
+  rwlock::UringLockRequest<> request(lock, rwlock::LockMode::kShared);
+  ASSERT_FALSE(request.acquire(
+      [&] {
+        ++calls;
+        return &sqe;
+      },
+      42));
+  ASSERT_EQ(calls, 1);
+  ASSERT_EQ(sqe.opcode, 51);
+  ASSERT_EQ(sqe.fd, 0x02 | 128);
+  ASSERT_EQ(sqe.addr,
+            reinterpret_cast<std::uint64_t>(&lock.futex_word()));
+  ASSERT_EQ(sqe.off, lock.futex_word().load());
+  ASSERT_EQ(sqe.addr3, 0xffffffffu);
+  ASSERT_EQ(sqe.user_data, 42u);
+
+  // No SQE is taken when the lock is free.
+  ASSERT_TRUE(lock.unlock());
+  ASSERT_TRUE(request.acquire(
+      [&] {
+        ++calls;
+        return &sqe;
+      },
+      42));
+  ASSERT_EQ(calls, 1);
+  ASSERT_EQ(lock.try_lock(), EBUSY);
+  ASSERT_TRUE(lock.unlock_shared());
+}
+
+// End to end through a real ring: the completion arrives when the holder
+// releases, and the next acquire() takes the lock.
+TEST(UringLockTest, TestCompletionOnRelease) {
+  TestRing ring;
+  if (!ring.ok()) {
+    GTEST_SKIP() << "io_uring unavailable";
+  }
+  rwlock::FutexRWLock lock;
+  ASSERT_EQ(lock.lock(), 0);
+
+  // Start the releasing thread before arming the wait: on recent kernels a
+  // private futex wait armed through io_uring while the process is still
+  // single-threaded is not found by wakes once a second thread exists.
+  std::atomic<bool> armed{false};
+  std::thread holder([&] {
+    while (!armed.load()) {
+      std::this_thread::yield();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    lock.unlock();
+  });
+
+  rwlock::UringLockRequest<> request(lock, rwlock::LockMode::kExclusive);
+  auto get_sqe = [&] { return ring.get_sqe(); };
+  ASSERT_FALSE(request.acquire(get_sqe, 7));
+  ASSERT_EQ(ring.submit(), 1);
+  armed.store(true);
+  bool acquired = false;
+  while (!acquired) {
+    const io_uring_cqe cqe = ring.wait_cqe();
+    ASSERT_EQ(cqe.user_data, 7u);
+    if (cqe.res == -EINVAL) {
+      holder.join();
+      GTEST_SKIP() << "kernel lacks IORING_OP_FUTEX_WAIT";
+    }
+    acquired = request.acquire(get_sqe, 7);
+    if (!acquired) {
+      ring.submit();
+    }
+  }
+  holder.join();
+  rwlock::BasicUniqueLock<rwlock::FutexRWLock> guard(lock, std::adopt_lock);
+  ASSERT_EQ(lock.try_lock_shared(), EBUSY);
+}
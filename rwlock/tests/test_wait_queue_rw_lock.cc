@@ -0,0 +1,176 @@
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <deque>
+#include <gtest/gtest.h>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include "rwlock/shared_lock.h"
+#include "rwlock/tests/counter_test.h"
+#include "rwlock/unique_lock.h"
+#include "rwlock/wait_queue_rw_lock.h"
+
+// Unlocking reports whether the lock was held, in either mode.
+TEST(WaitQueueRWLockTest, TestTryLock) {
+  rwlock::WaitQueueRWLock lock;
+
+  ASSERT_EQ(lock.try_lock(), 0);
+  ASSERT_EQ(lock.try_lock(), EBUSY);
+  ASSERT_EQ(lock.try_lock_shared(), EBUSY);
+  ASSERT_TRUE(lock.unlock());
+  ASSERT_FALSE(lock.unlock());
+
+  ASSERT_EQ(lock.try_lock_shared(), 0);
+  ASSERT_EQ(lock.try_lock_shared(), 0);
+  ASSERT_EQ(lock.try_lock(), EBUSY);
+  ASSERT_TRUE(lock.unlock_shared());
+  ASSERT_TRUE(lock.unlock());
+  ASSERT_FALSE(lock.unlock_shared());
+}
+
+// lock_when returns at once if the condition already holds.
+TEST(WaitQueueRWLockTest, TestLockWhenReady) {
+  rwlock::WaitQueueRWLock lock;
+  ASSERT_EQ(lock.lock_when([] { return true; }), 0);
+  rwlock::BasicUniqueLock<rwlock::WaitQueueRWLock> guard(lock,
+                                                         std::adopt_lock);
+  ASSERT_TRUE(guard.owns_lock());
+  ASSERT_EQ(lock.try_lock_shared(), EBUSY);
+}
+
+// Waiters only get the lock once their condition holds, and the releasing
+// thread is the one that checks it.
+TEST(WaitQueueRWLockTest, TestReleaserEvaluatesCondition) {
+  rwlock::WaitQueueRWLock lock;
+  int value = 0;
+  std::atomic<int> evaluations{0};
+  std::atomic<bool> done{false};
+
+  std::thread waiter([&] {
+    lock.lock_shared_when([&] {
+      evaluations.fetch_add(1);
+      return value >= 3;
+    });
+    rwlock::BasicSharedLock<rwlock::WaitQueueRWLock> guard(lock,
+                                                           std::adopt_lock);
+    ASSERT_GE(value, 3);
+    done.store(true);
+  });
+
+  while (evaluations.load() == 0) {
+    std::this_thread::yield();
+  }
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_FALSE(done.load());
+    rwlock::BasicUniqueLock<rwlock::WaitQueueRWLock> guard(lock);
+    ++value;
+  }
+  waiter.join();
+  ASSERT_TRUE(done.load());
+  // Once on enqueue, then once per release.
+  ASSERT_EQ(evaluations.load(), 4);
+}
+
+// A bounded queue with no condition variable: producers wait for room,
+// consumers wait for items.
+TEST(WaitQueueRWLockTest, TestProducerConsumer) {
+  rwlock::WaitQueueRWLock lock;
+  std::deque<int> queue;
+  const std::size_t kCapacity = 4;
+  const int kItems = 2000;
+  const int kProducers = 2;
+  const int kConsumers = 2;
+  std::atomic<long> sum{0};
+  std::atomic<int> consumed{0};
+
+  std::vector<std::thread> threads;
+  for (int p = 0; p < kProducers; ++p) {
+    threads.emplace_back([&] {
+      for (int i = 1; i <= kItems; ++i) {
+        lock.lock_when([&] { return queue.size() < kCapacity; });
+        rwlock::BasicUniqueLock<rwlock::WaitQueueRWLock> guard(
+            lock, std::adopt_lock);
+        queue.push_back(i);
+      }
+    });
+  }
+  for (int c = 0; c < kConsumers; ++c) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < kItems * kProducers / kConsumers; ++i) {
+        lock.lock_when([&] { return !queue.empty(); });
+        rwlock::BasicUniqueLock<rwlock::WaitQueueRWLock> guard(
+            lock, std::adopt_lock);
+        sum.fetch_add(queue.front());
+        queue.pop_front();
+        consumed.fetch_add(1);
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  ASSERT_EQ(consumed.load(), kItems * kProducers);
+  ASSERT_EQ(sum.load(), static_cast<long>(kItems) * (kItems + 1) / 2 *
+                            kProducers);
+  ASSERT_TRUE(queue.empty());
+}
+
+TEST(WaitQueueRWLockTest, TestContention) {
+  rwlock::WaitQueueRWLock lock;
+  run_counter_test<rwlock::WaitQueueRWLock, 4, 2000>(lock);
+}
+
+// A writer waiting behind readers holds off new readers.
+TEST(WaitQueueRWLockTest, TestWriterPreference) {
+  rwlock::WaitQueueRWLock lock;
+  ASSERT_EQ(lock.lock_shared(), 0);
+  std::thread writer([&] {
+    ASSERT_EQ(lock.lock(), 0);
+    lock.unlock();
+  });
+  while (lock.try_lock_shared() == 0) {
+    lock.unlock_shared();
+    std::this_thread::yield();
+  }
+  ASSERT_TRUE(lock.unlock_shared());
+  writer.join();
+  ASSERT_EQ(lock.try_lock_shared(), 0);
+  lock.unlock_shared();
+}
+
+// A cancelled waiter leaves the queue, and a cancelled ready writer stops
+// holding readers off.
+TEST(WaitQueueRWLockTest, TestStopToken) {
+  rwlock::WaitQueueRWLock lock;
+  ASSERT_EQ(lock.lock_shared(), 0);
+
+  std::stop_source source;
+  std::atomic<int> result{-1};
+  std::thread writer([&] { result.store(lock.lock(source.get_token())); });
+  // Wait for the writer to queue up.
+  while (lock.try_lock_shared() == 0) {
+    lock.unlock_shared();
+    std::this_thread::yield();
+  }
+  source.request_stop();
+  writer.join();
+  ASSERT_EQ(result.load(), ECANCELED);
+  ASSERT_EQ(lock.try_lock_shared(), 0);
+  ASSERT_TRUE(lock.unlock_shared());
+  ASSERT_TRUE(lock.unlock_shared());
+
+  // Waiting on a condition that never comes true.
+  std::stop_source never;
+  std::thread waiter([&] {
+    result.store(lock.lock_when([] { return false; }, never.get_token()));
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  never.request_stop();
+  waiter.join();
+  ASSERT_EQ(result.load(), ECANCELED);
+  ASSERT_EQ(lock.try_lock(), 0);
+  ASSERT_TRUE(lock.unlock());
+}
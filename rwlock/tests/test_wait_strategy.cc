@@ -0,0 +1,67 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <thread>
+
+#include "rwlock/futex.h"
+#include "rwlock/wait_strategy.h"
+
+// Waits until word changes, then checks that it did.
+template <class Wait> static void wait_for_change() {
+  std::atomic<std::uint32_t> word{0};
+  std::thread setter([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    word.store(1);
+    rwlock::detail::futex_wake(word);
+  });
+  Wait wait;
+  while (word.load() == 0) {
+    wait.wait(word, 0);
+  }
+  setter.join();
+  ASSERT_EQ(word.load(), 1u);
+}
+
+// Every strategy eventually observes a change to the word.
+TEST(WaitStrategyTest, TestStrategiesObserveChange) {
+  wait_for_change<rwlock::SpinWait>();
+  wait_for_change<rwlock::YieldWait>();
+  wait_for_change<rwlock::BackoffWait<>>();
+  wait_for_change<rwlock::SleepWait<>>();
+  wait_for_change<rwlock::ParkWait>();
+  wait_for_change<rwlock::DefaultWait>();
+}
+
+// wait() returns immediately when the word no longer holds the expected value.
+TEST(WaitStrategyTest, TestWaitReturnsOnMismatch) {
+  std::atomic<std::uint32_t> word{7};
+  rwlock::ParkWait park;
+  park.wait(word, 0); // would block forever if it ignored the value
+  rwlock::SpinWait spin;
+  spin.wait(word, 0);
+  SUCCEED();
+}
+
+// Only strategies that may block in the kernel report will_park().
+TEST(WaitStrategyTest, TestWillPark) {
+  ASSERT_FALSE(rwlock::SpinWait().will_park());
+  ASSERT_FALSE(rwlock::YieldWait().will_park());
+  ASSERT_FALSE(rwlock::BackoffWait<>().will_park());
+  ASSERT_FALSE(rwlock::SleepWait<>().will_park());
+  ASSERT_TRUE(rwlock::ParkWait().will_park());
+}
+
+// SpinThen spins for its budget before escalating to the next strategy.
+TEST(WaitStrategyTest, TestSpinThenEscalates) {
+  std::atomic<std::uint32_t> word{0};
+  rwlock::SpinThen<8, rwlock::ParkWait> wait;
+  ASSERT_FALSE(wait.will_park());
+  wait.wait(word, 0); // spends the whole spin budget
+  ASSERT_TRUE(wait.will_park());
+
+  rwlock::SpinThen<2, rwlock::YieldWait> polling;
+  polling.pause();
+  polling.pause();
+  ASSERT_FALSE(polling.will_park());
+}
@@ -1,22 +1,48 @@
 #pragma once
 
+#include "rwlock/qos_class.h"
 #include "rwlock/rw_lock.h"
+#include "rwlock/wait_strategy.h"
 #include <mutex>
+#include <stop_token>
 #include <thread>
 
 namespace rwlock {
 
 // Move‐only write‐lock guard (like std::unique_lock on a std::mutex). Takes
-// exclusive ownership of RWLock.
-class UniqueLock {
+// exclusive ownership of a read-write lock engine. Lock is RWLock or any
+// engine with the same interface (lock, try_lock, unlock returning the same
+// error codes); see shared_lock.h for which engines qualify.
+template <class Lock> class BasicUniqueLock {
 public:
-  explicit UniqueLock(RWLock &rwlock) : lock_(&rwlock), owns_lock_(false) {
+  explicit BasicUniqueLock(Lock &rwlock) : lock_(&rwlock), owns_lock_(false) {
     lock();
   }
 
+  // Blocks until the rwlock is acquired, as a request of class qos. Only for
+  // engines that serve waiters by class (QosRWLock). Later lock() calls on
+  // this guard use the same class.
+  BasicUniqueLock(Lock &rwlock, QosClass qos)
+    requires QosLock<Lock>
+      : lock_(&rwlock), owns_lock_(false), qos_(qos) {
+    lock();
+  }
+
+  // Blocks until the rwlock is acquired or stop is requested. Check
+  // owns_lock() to tell which.
+  BasicUniqueLock(Lock &rwlock, std::stop_token stop)
+      : lock_(&rwlock), owns_lock_(false) {
+    lock(std::move(stop));
+  }
+
   // Take ownership of the rwlock (blocking).
   void lock() {
-    int rc = lock_->lock();
+    int rc;
+    if constexpr (QosLock<Lock>) {
+      rc = lock_->lock(qos_);
+    } else {
+      rc = lock_->lock();
+    }
     if (rc == EINVAL || rc == EDEADLK) {
       lock_ = nullptr;
       throw std::system_error(rc, std::generic_category(),
@@ -25,6 +51,40 @@ public:
     owns_lock_ = true;
   }
 
+  // Take ownership of the rwlock (blocking), unless stop is requested
+  // first. Returns false, without the lock, if it was. Engines with their own
+  // stop_token overload are woken as soon as stop is requested; others are
+  // polled.
+  bool lock(std::stop_token stop) {
+    int rc;
+    if constexpr (requires(Lock &l) { l.lock(stop); }) {
+      rc = lock_->lock(stop);
+    } else {
+      SleepWait<> wait;
+      for (;;) {
+        if (stop.stop_requested()) {
+          rc = ECANCELED;
+          break;
+        }
+        rc = lock_->try_lock();
+        if (rc != EBUSY) {
+          break;
+        }
+        wait.pause();
+      }
+    }
+    if (rc == ECANCELED) {
+      return false;
+    }
+    if (rc != 0) {
+      lock_ = nullptr;
+      throw std::system_error(rc, std::generic_category(),
+                              "Failed to lock() UniqueLock.");
+    }
+    owns_lock_ = true;
+    return true;
+  }
+
   // Tries to take ownership of the rwlock (non-blocking).
   bool try_lock() {
     int rc = lock_->try_lock();
@@ -40,24 +100,40 @@ public:
   }
 
   // Tries to take ownership of the rwlock, returns if lock has been
-  // unavailable for the specified time duration.
-  template <class Rep, class Period>
-  bool
-  try_lock_for(const std::chrono::duration<Rep, Period> &timeout_duration) {
-    return try_lock_until(std::chrono::steady_clock::now() + timeout_duration);
+  // unavailable for the specified time duration. wait decides how to back off
+  // between attempts (see wait_strategy.h).
+  template <class Rep, class Period, class Wait = SleepWait<>>
+  bool try_lock_for(const std::chrono::duration<Rep, Period> &timeout_duration,
+                    Wait wait = Wait()) {
+    return try_lock_until(std::chrono::steady_clock::now() + timeout_duration,
+                          wait);
   }
 
   // Tries to take ownership of the rwlock, returns if the mutex has been
-  // unavailable until specified time point has been reached.
-  template <class Clock, class Duration>
+  // unavailable until specified time point has been reached. Engines with
+  // their own timed acquisition (AbortableQueueRWLock) wait in their queue
+  // instead of polling.
+  template <class Clock, class Duration, class Wait = SleepWait<>>
   bool
-  try_lock_until(const std::chrono::time_point<Clock, Duration> &timeout_time) {
-    using namespace std::chrono;
+  try_lock_until(const std::chrono::time_point<Clock, Duration> &timeout_time,
+                 Wait wait = Wait()) {
+    if constexpr (requires(Lock &l) { l.try_lock_until(timeout_time); }) {
+      // The engine can wait in its queue and leave it at the deadline.
+      int rc = lock_->try_lock_until(timeout_time);
+      if (rc == 0) {
+        owns_lock_ = true;
+      } else if (rc != ETIMEDOUT && rc != EBUSY && rc != EAGAIN) {
+        lock_ = nullptr;
+        throw std::system_error(rc, std::generic_category(),
+                                "Failed to try_lock_until() UniqueLock.");
+      }
+      return owns_lock_;
+    }
     while (Clock::now() < timeout_time) {
       if (try_lock()) {
         return true;
       }
-      std::this_thread::sleep_for(0.01ms);
+      wait.pause();
     }
     return false; // Timed out
   }
@@ -70,39 +146,52 @@ public:
   }
 
   // Swaps state with another unique lock.
-  void swap(UniqueLock &other) {
+  void swap(BasicUniqueLock &other) {
     std::swap(lock_, other.lock_);
     std::swap(owns_lock_, other.owns_lock_);
+    std::swap(qos_, other.qos_);
   }
 
   // Disassociates the rwlock without unlocking (i.e., releasing
   // ownership of) it.
-  RWLock *release() {
-    RWLock *temp = lock_;
+  Lock *release() {
+    Lock *temp = lock_;
     lock_ = nullptr;
     owns_lock_ = false;
     return temp;
   }
 
   // Returns a pointer to the associated mutex
-  RWLock *rwlock() { return lock_; }
+  Lock *rwlock() { return lock_; }
 
   // Returns true if we currently own an exclusive lock
   bool owns_lock() const noexcept { return owns_lock_; }
 
-  ~UniqueLock() {
+  // Returns the QoS class this guard requests the lock with
+  QosClass qos() const noexcept
+    requires QosLock<Lock>
+  {
+    return qos_;
+  }
+
+  ~BasicUniqueLock() {
     if (owns_lock_) {
       lock_->unlock();
     }
   }
 
-  UniqueLock(UniqueLock &&other) noexcept
-      : lock_(other.lock_), owns_lock_(other.owns_lock_) {
+  // Takes ownership of a lock the caller already holds in exclusive mode, e.g.
+  // after lock_when().
+  BasicUniqueLock(Lock &rwlock, std::adopt_lock_t) noexcept
+      : lock_(&rwlock), owns_lock_(true) {}
+
+  BasicUniqueLock(BasicUniqueLock &&other) noexcept
+      : lock_(other.lock_), owns_lock_(other.owns_lock_), qos_(other.qos_) {
     other.lock_ = nullptr;
     other.owns_lock_ = false;
   }
 
-  UniqueLock &operator=(UniqueLock &&other) noexcept {
+  BasicUniqueLock &operator=(BasicUniqueLock &&other) noexcept {
     if (this != &other) {
       // If we own a lock, unlock before overwriting
       if (owns_lock_) {
@@ -110,6 +199,7 @@ public:
       }
       lock_ = other.lock_;
       owns_lock_ = other.owns_lock_;
+      qos_ = other.qos_;
 
       other.lock_ = nullptr;
       other.owns_lock_ = false;
@@ -117,12 +207,15 @@ public:
     return *this;
   }
 
-  UniqueLock(const UniqueLock &) = delete;
-  UniqueLock &operator=(const UniqueLock &) = delete;
+  BasicUniqueLock(const BasicUniqueLock &) = delete;
+  BasicUniqueLock &operator=(const BasicUniqueLock &) = delete;
 
 private:
-  RWLock *lock_;
+  Lock *lock_;
   bool owns_lock_;
+  QosClass qos_ = QosClass::kNormal;
 };
 
-} // namespace rwlock
\ No newline at end of file
+using UniqueLock = BasicUniqueLock<RWLock>;
+
+} // namespace rwlock
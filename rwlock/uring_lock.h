@@ -0,0 +1,89 @@
+#pragma once
+
+#include "rwlock/futex_rw_lock.h"
+#include "rwlock/multi_lock.h"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#include <linux/futex.h>
+#include <linux/io_uring.h>
+
+namespace rwlock {
+namespace detail {
+
+// IORING_OP_FUTEX_WAIT arrived in Linux 6.7; older headers lack it, so spell
+// out the ABI value.
+inline constexpr std::uint8_t kIoringOpFutexWait = 51;
+
+// Fills sqe with a futex wait on word that completes once the word no longer
+// holds expected and a wake arrives, or at once (-EAGAIN) if it already
+// differs. Same encoding as liburing's io_uring_prep_futex_wait.
+inline void prep_futex_wait(io_uring_sqe *sqe,
+                            const std::atomic<std::uint32_t> &word,
+                            std::uint32_t expected, std::uint64_t user_data) {
+  std::memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = kIoringOpFutexWait;
+  sqe->fd = static_cast<std::int32_t>(kFutex2SizeU32 | kFutex2Private);
+  sqe->addr = reinterpret_cast<std::uint64_t>(futex_addr(word));
+  sqe->off = expected;
+  sqe->addr3 = FUTEX_BITSET_MATCH_ANY;
+  sqe->user_data = user_data;
+}
+
+} // namespace detail
+
+// Acquires a FutexRWLock from an io_uring event loop without blocking the
+// thread. When the lock is contended, acquire() hands back a futex wait on
+// the lock word for the loop to submit alongside its socket I/O; when that
+// completes, the loop calls acquire() again.
+//
+//   UringLockRequest<> request(lock, LockMode::kShared);
+//   if (!request.acquire([&] { return io_uring_get_sqe(&ring); }, tag)) {
+//     // ... later, on the completion tagged `tag` (whatever its result):
+//     if (request.acquire(get_sqe, tag)) { /* lock held */ }
+//   }
+//   BasicSharedLock<FutexRWLock> guard(lock, std::adopt_lock);
+//
+// Requires Linux 6.7+ for IORING_OP_FUTEX_WAIT; older kernels complete the
+// wait with -EINVAL. Lock is any engine with try_lock, try_lock_shared,
+// futex_word and prepare_park. A waiting async writer does not hold off new
+// readers the way a blocked FutexRWLock::lock() does.
+template <class Lock = FutexRWLock> class UringLockRequest {
+public:
+  UringLockRequest(Lock &rwlock, LockMode mode) : lock_(&rwlock), mode_(mode) {}
+
+  // Tries to take the lock. Returns true if it is now held. Otherwise fills
+  // the SQE returned by get_sqe() (which must be free) with a wait tagged
+  // user_data, for the caller to submit, and returns false.
+  template <class GetSqe>
+  bool acquire(GetSqe &&get_sqe, std::uint64_t user_data) {
+    if (try_acquire()) {
+      return true;
+    }
+    const std::uint32_t expected = lock_->prepare_park();
+    // A release before prepare_park would never wake the wait.
+    if (try_acquire()) {
+      return true;
+    }
+    detail::prep_futex_wait(get_sqe(), lock_->futex_word(), expected,
+                            user_data);
+    return false;
+  }
+
+  // Returns a pointer to the associated lock
+  Lock *rwlock() { return lock_; }
+
+  LockMode mode() const { return mode_; }
+
+private:
+  bool try_acquire() {
+    return (mode_ == LockMode::kShared ? lock_->try_lock_shared()
+                                       : lock_->try_lock()) == 0;
+  }
+
+  Lock *lock_;
+  LockMode mode_;
+};
+
+} // namespace rwlock
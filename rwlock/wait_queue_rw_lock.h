@@ -0,0 +1,278 @@
+#pragma once
+
+#include "rwlock/waiter_queue.h"
+#include <cerrno>
+#include <cstdint>
+#include <mutex>
+#include <stop_token>
+
+#include <unistd.h>
+
+namespace rwlock {
+
+class EventFdLockRequest;
+
+// Read-write lock whose waiters can also wait for a condition on the data it
+// protects, like absl::Mutex::Await. lock_when(pred) returns holding the lock
+// exclusively with pred() true; lock_shared_when(pred) the same in shared
+// mode. Guard a lock taken that way with the guards' std::adopt_lock
+// constructors.
+//
+// Waiters queue in FIFO order. The thread that releases the lock evaluates
+// the queued predicates and hands the lock directly to the waiters that can
+// now run, so nobody wakes up just to find its condition still false.
+// Predicates are called with the lock's data stable (no writer active), from
+// whichever thread releases the lock; they must be cheap and must not throw or
+// touch the lock.
+//
+// A writer whose turn has come holds off new readers. The blocking calls take
+// an optional std::stop_token to leave the queue early.
+class WaitQueueRWLock {
+public:
+  WaitQueueRWLock() = default;
+
+  // Acquire write lock (exclusive). Blocking.
+  int lock() { return lock_impl(/*exclusive=*/true, Condition(), nullptr); }
+
+  // Acquire write lock (exclusive). Blocking until acquired or stop is
+  // requested. If rc == ECANCELED, stop was requested and the lock was not
+  // taken.
+  int lock(std::stop_token stop) {
+    return lock_impl(/*exclusive=*/true, Condition(), &stop);
+  }
+
+  // Acquire write lock (exclusive) once pred() holds. Blocking.
+  template <class Predicate> int lock_when(Predicate pred) {
+    return lock_impl(/*exclusive=*/true, Condition(pred), nullptr);
+  }
+
+  // As lock_when, but gives up with ECANCELED if stop is requested first.
+  template <class Predicate>
+  int lock_when(Predicate pred, std::stop_token stop) {
+    return lock_impl(/*exclusive=*/true, Condition(pred), &stop);
+  }
+
+  // Acquire write lock (exclusive). Non-blocking.
+  // If rc == EBUSY, lock is held for reading or writing.
+  int try_lock() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (state_ != 0) {
+      return EBUSY;
+    }
+    state_ = kWriter;
+    return 0;
+  }
+
+  // Acquire read lock (shared). Blocking.
+  int lock_shared() {
+    return lock_impl(/*exclusive=*/false, Condition(), nullptr);
+  }
+
+  // Acquire read lock (shared). Blocking until acquired or stop is requested.
+  // If rc == ECANCELED, stop was requested and the lock was not taken.
+  int lock_shared(std::stop_token stop) {
+    return lock_impl(/*exclusive=*/false, Condition(), &stop);
+  }
+
+  // Acquire read lock (shared) once pred() holds. Blocking.
+  template <class Predicate> int lock_shared_when(Predicate pred) {
+    return lock_impl(/*exclusive=*/false, Condition(pred), nullptr);
+  }
+
+  // As lock_shared_when, but gives up with ECANCELED if stop is requested
+  // first.
+  template <class Predicate>
+  int lock_shared_when(Predicate pred, std::stop_token stop) {
+    return lock_impl(/*exclusive=*/false, Condition(pred), &stop);
+  }
+
+  // Acquire read lock (shared). Non-blocking.
+  // If rc == EBUSY, a writer holds or is waiting for the lock.
+  int try_lock_shared() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (state_ == kWriter || writer_ready_) {
+      return EBUSY;
+    }
+    ++state_;
+    return 0;
+  }
+
+  // Unlock from either a read or a write lock. Returns false if the lock was
+  // not held.
+  bool unlock() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (state_ == 0) {
+      return false;
+    }
+    state_ = state_ == kWriter ? 0 : state_ - 1;
+    if (state_ == 0) {
+      grant_waiters();
+    }
+    return true;
+  }
+
+  // Unlock a read lock. Returns false if no read lock was held.
+  bool unlock_shared() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (state_ <= 0) {
+      return false;
+    }
+    if (--state_ == 0) {
+      grant_waiters();
+    }
+    return true;
+  }
+
+  // Disallow move.
+  WaitQueueRWLock(WaitQueueRWLock &&other) = delete;
+  WaitQueueRWLock &operator=(WaitQueueRWLock &&other) = delete;
+
+  // Disallow copy.
+  WaitQueueRWLock(const WaitQueueRWLock &) = delete;
+  WaitQueueRWLock &operator=(const WaitQueueRWLock &) = delete;
+
+private:
+  static constexpr int kWriter = -1;
+
+  // Type-erased reference to a predicate on the caller's stack. Empty means
+  // always true.
+  class Condition {
+  public:
+    Condition() = default;
+
+    template <class Predicate>
+    explicit Condition(Predicate &pred)
+        : eval_([](void *p) { return (*static_cast<Predicate *>(p))(); }),
+          pred_(&pred) {}
+
+    bool operator()() const { return eval_ == nullptr || eval_(pred_); }
+
+  private:
+    bool (*eval_)(void *) = nullptr;
+    void *pred_ = nullptr;
+  };
+
+  // A queued acquisition, living on the waiting thread's stack (or in an
+  // EventFdLockRequest).
+  struct Waiter {
+    bool exclusive;
+    Condition condition;
+    // If set, the grant is also signalled by writing to this eventfd.
+    int eventfd = -1;
+    Waiter *prev = nullptr;
+    Waiter *next = nullptr;
+    // kGranted once the lock has been handed over, kCancelled if the wait
+    // was given up.
+    detail::WaitSlot slot{};
+  };
+
+  friend class EventFdLockRequest;
+
+  int lock_impl(bool exclusive, Condition condition,
+                const std::stop_token *stop) {
+    if (stop != nullptr && stop->stop_requested()) {
+      return ECANCELED;
+    }
+    Waiter waiter{exclusive, condition};
+    if (acquire_or_enqueue(&waiter)) {
+      return 0;
+    }
+    if (stop == nullptr) {
+      return await(waiter);
+    }
+    // Runs right here if stop was requested in the meantime.
+    std::stop_callback on_stop(*stop, [&] { cancel(&waiter); });
+    return await(waiter);
+  }
+
+  // Takes the lock for w if it is free and w's condition holds. Otherwise
+  // queues w and returns false.
+  bool acquire_or_enqueue(Waiter *w) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    // Nobody can take the lock while we hold mutex_, so the data is stable
+    // enough to evaluate the condition whenever no writer is active.
+    if (w->exclusive) {
+      if (state_ == 0 && w->condition()) {
+        state_ = kWriter;
+        return true;
+      }
+      if (state_ > 0 && w->condition()) {
+        writer_ready_ = true;
+      }
+    } else if (state_ != kWriter && !writer_ready_ && w->condition()) {
+      ++state_;
+      return true;
+    }
+    queue_.push_back(w);
+    return false;
+  }
+
+  int await(Waiter &waiter) {
+    return waiter.slot.wait() == detail::WaitSlot::kGranted ? 0 : ECANCELED;
+  }
+
+  // Stop callback: takes the waiter out of the queue unless it has already
+  // been granted the lock.
+  void cancel(Waiter *w) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (w->slot.load(std::memory_order_relaxed) !=
+        detail::WaitSlot::kWaiting) {
+      return;
+    }
+    queue_.erase(w);
+    w->slot.resolve(detail::WaitSlot::kCancelled);
+    // It may have been the ready writer holding everyone else off.
+    if (state_ != kWriter) {
+      grant_waiters();
+    }
+  }
+
+  // Hands the now free lock to queued waiters whose conditions hold: every
+  // ready reader up to the first ready writer, or that writer alone if it
+  // comes first. Called with mutex_ held and no writer active.
+  void grant_waiters() {
+    writer_ready_ = false;
+    Waiter *w = queue_.front();
+    while (w != nullptr) {
+      Waiter *next = w->next;
+      if (w->exclusive) {
+        if (w->condition()) {
+          if (state_ == 0) {
+            state_ = kWriter;
+            grant(w);
+          } else {
+            // Readers granted in this pass go first; hold off new ones.
+            writer_ready_ = true;
+          }
+          return;
+        }
+      } else if (w->condition()) {
+        ++state_;
+        grant(w);
+      }
+      w = next;
+    }
+  }
+
+  void grant(Waiter *w) {
+    queue_.erase(w);
+    // A blocked waiter may return once resolved; read the eventfd first. An
+    // EventFdLockRequest takes mutex_ before it goes away, so its fd stays
+    // valid.
+    const int fd = w->eventfd;
+    w->slot.resolve(detail::WaitSlot::kGranted);
+    if (fd >= 0) {
+      const std::uint64_t one = 1;
+      [[maybe_unused]] ssize_t rc = write(fd, &one, sizeof(one));
+    }
+  }
+
+  std::mutex mutex_;
+  int state_ = 0; // kWriter, or the number of readers holding the lock.
+  // A queued writer's condition held but readers were still in; new readers
+  // wait until it has had its turn.
+  bool writer_ready_ = false;
+  detail::WaiterQueue<Waiter> queue_;
+};
+
+} // namespace rwlock
@@ -0,0 +1,187 @@
+#pragma once
+
+#include "rwlock/futex.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+namespace rwlock {
+
+// Wait strategies decide how a thread waits for a lock. A strategy object is
+// created for each acquisition and called every time the acquisition has to
+// wait, so it can escalate (e.g. spin first, then park). Every strategy
+// provides:
+//
+//   bool will_park() const
+//     True if the next wait() may block in the kernel. The caller must then
+//     make sure whoever changes the word also calls detail::futex_wake on it.
+//   void wait(const std::atomic<uint32_t> &word, uint32_t expected)
+//     Waits while word == expected. May return early or spuriously.
+//   void pause()
+//     Backs off once between attempts of a polling loop with no word to wait
+//     on, e.g. the guards' try_lock_until.
+//
+// Engines take a strategy as a template parameter; the guards' timed paths
+// take one as an argument.
+
+// Hints the CPU that we are in a spin loop.
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#else
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+// Busy-waits with the CPU's pause hint. For pinned threads where latency
+// matters more than the cycles burnt; never gives up the CPU.
+class SpinWait {
+public:
+  // Pause hints per wait() call before returning to the caller's loop.
+  static constexpr int kSpinsPerWait = 64;
+
+  bool will_park() const { return false; }
+
+  void wait(const std::atomic<std::uint32_t> &word, std::uint32_t expected) {
+    for (int i = 0; i < kSpinsPerWait; ++i) {
+      if (word.load(std::memory_order_relaxed) != expected) {
+        return;
+      }
+      cpu_relax();
+    }
+  }
+
+  void pause() { cpu_relax(); }
+};
+
+// Gives up the rest of the time slice on every wait.
+class YieldWait {
+public:
+  bool will_park() const { return false; }
+
+  void wait(const std::atomic<std::uint32_t> &word, std::uint32_t expected) {
+    if (word.load(std::memory_order_relaxed) == expected) {
+      std::this_thread::yield();
+    }
+  }
+
+  void pause() { std::this_thread::yield(); }
+};
+
+// Spins for an exponentially growing, randomly jittered number of pause
+// hints, capped at kMaxSpins. Jitter keeps contending threads from retrying
+// in lockstep.
+template <int kMinSpins = 4, int kMaxSpins = 4096> class BackoffWait {
+public:
+  bool will_park() const { return false; }
+
+  void wait(const std::atomic<std::uint32_t> &word, std::uint32_t expected) {
+    const int spins = next_spins();
+    for (int i = 0; i < spins; ++i) {
+      if (word.load(std::memory_order_relaxed) != expected) {
+        return;
+      }
+      cpu_relax();
+    }
+  }
+
+  void pause() {
+    const int spins = next_spins();
+    for (int i = 0; i < spins; ++i) {
+      cpu_relax();
+    }
+  }
+
+private:
+  // Returns a spin count in [limit / 2, limit] and doubles the limit.
+  int next_spins() {
+    thread_local std::uint32_t seed =
+        static_cast<std::uint32_t>(
+            std::hash<std::thread::id>()(std::this_thread::get_id())) |
+        1;
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    const int spins = limit_ / 2 + static_cast<int>(seed % (limit_ / 2 + 1));
+    if (limit_ < kMaxSpins) {
+      limit_ *= 2;
+    }
+    return spins;
+  }
+
+  int limit_ = kMinSpins < 2 ? 2 : kMinSpins;
+};
+
+// Sleeps for a fixed interval. This is what the guards' timed paths always
+// did, and stays their default.
+template <int kMicros = 10> class SleepWait {
+public:
+  bool will_park() const { return false; }
+
+  void wait(const std::atomic<std::uint32_t> &word, std::uint32_t expected) {
+    if (word.load(std::memory_order_relaxed) == expected) {
+      pause();
+    }
+  }
+
+  void pause() {
+    std::this_thread::sleep_for(std::chrono::microseconds(kMicros));
+  }
+};
+
+// Parks the thread on the word with futex(2) right away. For oversubscribed
+// threads that should not burn CPU. Polling loops have no word to park on and
+// sleep instead.
+class ParkWait {
+public:
+  bool will_park() const { return true; }
+
+  void wait(const std::atomic<std::uint32_t> &word, std::uint32_t expected) {
+    detail::futex_wait(word, expected);
+  }
+
+  void pause() { std::this_thread::sleep_for(std::chrono::microseconds(10)); }
+};
+
+// Spins for kSpins pause hints in total, then hands over to Next, e.g.
+// SpinThen<100, ParkWait> spins briefly before parking.
+template <int kSpins, class Next = ParkWait> class SpinThen {
+public:
+  bool will_park() const { return spins_ >= kSpins && next_.will_park(); }
+
+  void wait(const std::atomic<std::uint32_t> &word, std::uint32_t expected) {
+    if (spins_ >= kSpins) {
+      next_.wait(word, expected);
+      return;
+    }
+    while (spins_ < kSpins) {
+      ++spins_;
+      if (word.load(std::memory_order_relaxed) != expected) {
+        return;
+      }
+      cpu_relax();
+    }
+  }
+
+  void pause() {
+    if (spins_ < kSpins) {
+      ++spins_;
+      cpu_relax();
+      return;
+    }
+    next_.pause();
+  }
+
+private:
+  int spins_ = 0;
+  Next next_;
+};
+
+// Default for engines that wait on a word: a short spin, then park.
+using DefaultWait = SpinThen<128, ParkWait>;
+
+} // namespace rwlock
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "rwlock/futex.h"
+#include "rwlock/wait_strategy.h"
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+
+namespace rwlock {
+namespace detail {
+
+// What a thread queued in one of the mutex-guarded engines (WaitQueueRWLock,
+// AbortableQueueRWLock, QosRWLock) waits on. The thread that takes it off the
+// queue, holding the engine's mutex, resolves it. The waiter spins on it
+// briefly and then sleeps on it alone, so a release wakes exactly the waiters
+// it admits.
+class WaitSlot {
+public:
+  // Outcomes.
+  static constexpr std::uint32_t kWaiting = 0;
+  static constexpr std::uint32_t kGranted = 1;
+  static constexpr std::uint32_t kCancelled = 2;
+
+  WaitSlot() = default;
+
+  // The outcome, or kWaiting while there is none yet.
+  std::uint32_t load(std::memory_order order) const {
+    const std::uint32_t s = state_.load(order);
+    return s == kParked ? kWaiting : s;
+  }
+
+  // Waits for the outcome and returns it. With a deadline (an absolute
+  // CLOCK_MONOTONIC time), returns kWaiting if it passes first; the caller
+  // must then take the waiter out of the queue, holding the engine's mutex,
+  // or find it resolved after all.
+  std::uint32_t wait(const struct timespec *deadline = nullptr) {
+    for (int i = 0; i < kSpins; ++i) {
+      const std::uint32_t s = state_.load(std::memory_order_acquire);
+      if (s != kWaiting) {
+        return s;
+      }
+      cpu_relax();
+    }
+    std::uint32_t s = kWaiting;
+    if (!state_.compare_exchange_strong(s, kParked,
+                                        std::memory_order_acquire)) {
+      return s; // Resolved while we were spinning.
+    }
+    while ((s = state_.load(std::memory_order_acquire)) == kParked) {
+      if (deadline == nullptr) {
+        futex_wait(state_, kParked);
+      } else if (!futex_wait_until(state_, kParked, *deadline)) {
+        return load(std::memory_order_acquire);
+      }
+    }
+    return s;
+  }
+
+  // Publishes outcome, waking the waiter if it sleeps. The waiter may return
+  // as soon as it sees the outcome, so the slot must not be touched again; a
+  // wake landing on its dead stack slot is at worst a spurious wakeup for
+  // whoever reuses it.
+  void resolve(std::uint32_t outcome) {
+    if (state_.exchange(outcome, std::memory_order_release) == kParked) {
+      futex_wake(state_, 1);
+    }
+  }
+
+  // Disallow move.
+  WaitSlot(WaitSlot &&other) = delete;
+  WaitSlot &operator=(WaitSlot &&other) = delete;
+
+  // Disallow copy.
+  WaitSlot(const WaitSlot &) = delete;
+  WaitSlot &operator=(const WaitSlot &) = delete;
+
+private:
+  // Still waiting, asleep: resolve() must wake.
+  static constexpr std::uint32_t kParked = 3;
+
+  // Spins on the slot before sleeping.
+  static constexpr int kSpins = 128;
+
+  std::atomic<std::uint32_t> state_{kWaiting};
+};
+
+// Intrusive FIFO of waiters that live on their threads' stacks, guarded by
+// the engine's mutex. Waiter has prev and next pointers. Doubly linked, so a
+// waiter that gives up can leave from anywhere in the queue.
+template <class Waiter> class WaiterQueue {
+public:
+  bool empty() const { return head_ == nullptr; }
+
+  Waiter *front() const { return head_; }
+
+  void push_back(Waiter *w) {
+    w->prev = tail_;
+    w->next = nullptr;
+    (tail_ != nullptr ? tail_->next : head_) = w;
+    tail_ = w;
+  }
+
+  void erase(Waiter *w) {
+    (w->prev != nullptr ? w->prev->next : head_) = w->next;
+    (w->next != nullptr ? w->next->prev : tail_) = w->prev;
+  }
+
+private:
+  Waiter *head_ = nullptr;
+  Waiter *tail_ = nullptr;
+};
+
+} // namespace detail
+} // namespace rwlock
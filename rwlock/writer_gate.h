@@ -0,0 +1,107 @@
+#pragma once
+
+#include "rwlock/futex.h"
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <thread>
+
+namespace rwlock {
+namespace detail {
+
+// Writer side of the engines whose readers register away from the writer
+// (SnziRWLock, PerCpuRWLock, AsymmetricRWLock): a futex word a writer holds
+// while it drains the readers and then while it has the lock, plus the
+// owning thread, for EDEADLK and for telling a write unlock from a read
+// unlock. Readers register first, then check state() and, if it is not
+// kFree, count themselves out again and park().
+class WriterGate {
+public:
+  static constexpr std::uint32_t kFree = 0;
+
+  WriterGate() = default;
+
+  // Blocks until the calling thread holds the gate. Returns EDEADLK if it
+  // already did.
+  int lock() {
+    const std::thread::id self = std::this_thread::get_id();
+    if (owner_.load(std::memory_order_relaxed) == self) {
+      return EDEADLK;
+    }
+    std::uint32_t w = kFree;
+    while (!word_.compare_exchange_strong(w, kHeld,
+                                          std::memory_order_seq_cst)) {
+      park(w);
+      w = kFree;
+    }
+    owner_.store(self, std::memory_order_relaxed);
+    return 0;
+  }
+
+  // Takes the gate if it is free. Returns EDEADLK if the calling thread
+  // already holds it, EBUSY if another thread does.
+  int try_lock() {
+    const std::thread::id self = std::this_thread::get_id();
+    if (owner_.load(std::memory_order_relaxed) == self) {
+      return EDEADLK;
+    }
+    std::uint32_t w = kFree;
+    if (!word_.compare_exchange_strong(w, kHeld,
+                                       std::memory_order_seq_cst)) {
+      return EBUSY;
+    }
+    owner_.store(self, std::memory_order_relaxed);
+    return 0;
+  }
+
+  // Releases the gate and wakes the threads parked on it. Returns false,
+  // doing nothing, if the calling thread does not hold it.
+  bool unlock() {
+    if (owner_.load(std::memory_order_relaxed) !=
+        std::this_thread::get_id()) {
+      return false;
+    }
+    owner_.store(std::thread::id(), std::memory_order_relaxed);
+    if (word_.exchange(kFree, std::memory_order_seq_cst) == kHeldParked) {
+      futex_wake(word_);
+    }
+    return true;
+  }
+
+  // kFree unless a writer holds the gate or is draining readers.
+  std::uint32_t state(std::memory_order order) const {
+    return word_.load(order);
+  }
+
+  // Sleeps while the gate is still in state w (a held state read from
+  // state()), flagging it so that unlock() wakes us. May return early;
+  // callers re-check.
+  void park(std::uint32_t w) {
+    if (w == kHeld &&
+        !word_.compare_exchange_strong(w, kHeldParked,
+                                       std::memory_order_relaxed)) {
+      return; // Changed meanwhile: retry.
+    }
+    if (w != kFree) {
+      futex_wait(word_, kHeldParked);
+    }
+  }
+
+  // Disallow move.
+  WriterGate(WriterGate &&other) = delete;
+  WriterGate &operator=(WriterGate &&other) = delete;
+
+  // Disallow copy.
+  WriterGate(const WriterGate &) = delete;
+  WriterGate &operator=(const WriterGate &) = delete;
+
+private:
+  static constexpr std::uint32_t kHeld = 1;
+  static constexpr std::uint32_t kHeldParked = 2; // Someone waits on word_.
+
+  std::atomic<std::uint32_t> word_{kFree};
+  std::atomic<std::thread::id> owner_{};
+};
+
+} // namespace detail
+} // namespace rwlock